@@ -0,0 +1,387 @@
+/****************************************************************************
+	  b_bench.c: Drives the B+ tree engine through a workload and
+		     reports its throughput and latency as JSON.
+			  Georgios Drakopoulos
+
+   Syntax: b_bench [-w workload] [-n ops] [-p preload] [-r read percent]
+		   [-l scan length] [-z zipf exponent] [-s seed] [-f file]
+		   [-m plain|epsilon|counted] [-t memtable keys] [-b bloom keys]
+
+   Workloads:
+	seq	inserts in ascending key order
+	uniform	inserts of uniformly random keys
+	zipf	inserts of Zipf-distributed keys
+	lookup	point lookups of uniformly random keys
+	scan	range scans of scan length keys from a random start
+	mixed	lookups and uniform inserts,read percent of them lookups
+   lookup,scan and mixed first load preload uniform keys,untimed.
+   -m epsilon runs the workload on a B-epsilon index file,-m counted on
+   one that keeps subtree counts (scans then count their range),and -t holds
+   that many inserts in a memtable;its final drain is part of the timing.
+   -b builds a Bloom filter planned for that many keys after the preload.
+   Build: cc -o b_bench b_bench.c b_tree.c -lm
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L  /*clock_gettime() under a strict -std*/
+
+#include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "b_plus.h"
+
+#define KEY_SPACE (WORD_T_MAX+1L)  /*the number of distinct keys*/
+
+/*the settings of a benchmark run*/
+typedef struct
+{
+  const char *workload;  /*the name of the workload*/
+  const char *name;  /*the index file to create*/
+  const char *mode;  /*plain,epsilon or counted*/
+  unsigned long ops;  /*the number of timed operations*/
+  unsigned long preload;  /*the keys loaded before lookups and scans*/
+  unsigned long seed;  /*the seed of the key generator*/
+  unsigned long memtable;  /*the capacity of the memtable,0 for none*/
+  unsigned long bloom;  /*the keys the Bloom filter is planned for,or 0*/
+  int read_percent;  /*the share of lookups in the mixed workload*/
+  word_t scan_length;  /*the width of the range of a scan*/
+  double zipf_exponent;  /*the skew of the Zipf distribution*/
+} bench_t;
+
+static unsigned long random_state;  /*the state of next_random()*/
+static double *zipf_cdf;  /*the cumulative Zipf distribution by rank*/
+
+/****************************************************************************
+		      main function-argument parsing
+   -INPUT: The options described above.
+   -OUTPUT: A symbolic value defined in <stdlib.h>
+****************************************************************************/
+static void parse_options(int argc,char *argv[],bench_t *const b);
+static void run_bench(const bench_t *const b);
+static void error(const char *const format,...);
+
+int main(int argc,char *argv[]);
+int main(int argc,char *argv[])
+{
+  bench_t bench;
+
+  bench.workload="uniform";
+  bench.name="bench.idx";
+  bench.mode="plain";
+  bench.ops=50000UL;
+  bench.preload=50000UL;
+  bench.seed=1UL;
+  bench.memtable=0UL;
+  bench.bloom=0UL;
+  bench.read_percent=50;
+  bench.scan_length=100;
+  bench.zipf_exponent=0.99;
+  parse_options(argc,argv,&bench);
+  run_bench(&bench);
+  return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+	error: Prints a message in stderr and quits the program.
+   -INPUT: The error message.
+   -OUTPUT: A symbolic value defined in <stdlib.h>
+****************************************************************************/
+static void error(const char *const format,...)
+{
+  va_list arg_ptr;  /*pointer to argument list*/
+
+  va_start(arg_ptr,format);
+  if(format==NULL)
+    fprintf(stderr,"%s","An unknown error has occured.\n");
+  else vfprintf(stderr,format,arg_ptr);
+  exit(EXIT_FAILURE);
+  va_end(arg_ptr);
+}
+
+/****************************************************************************
+	  parse_options: Reads the command line into the settings.
+   -INPUT: The arguments of main() and the settings to fill.
+   -OUTPUT: None.
+****************************************************************************/
+static void parse_options(int argc,char *argv[],bench_t *const b)
+{
+  const char *const syntax="Syntax: b_bench [-w seq|uniform|zipf|lookup|scan|\
+mixed] [-n ops] [-p preload] [-r read percent] [-l scan length] [-z zipf \
+exponent] [-s seed] [-f file] [-m plain|epsilon|counted] [-t memtable keys] \
+[-b bloom keys]\n";
+  int index;
+
+  for(index=1;index<argc;index+=2)
+  {
+    if(argv[index][0]!='-'||argv[index][1]=='\0'||argv[index][2]!='\0'||
+       index+1==argc)
+      error("%s",syntax);
+    switch(argv[index][1])
+    {
+      case 'w':
+	b->workload=argv[index+1];
+	break;
+      case 'n':
+	b->ops=strtoul(argv[index+1],NULL,10);
+	break;
+      case 'p':
+	b->preload=strtoul(argv[index+1],NULL,10);
+	break;
+      case 'r':
+	b->read_percent=atoi(argv[index+1]);
+	break;
+      case 'l':
+	b->scan_length=(word_t)strtoul(argv[index+1],NULL,10);
+	break;
+      case 'z':
+	b->zipf_exponent=atof(argv[index+1]);
+	break;
+      case 's':
+	b->seed=strtoul(argv[index+1],NULL,10);
+	break;
+      case 'f':
+	b->name=argv[index+1];
+	break;
+      case 'm':
+	b->mode=argv[index+1];
+	break;
+      case 't':
+	b->memtable=strtoul(argv[index+1],NULL,10);
+	break;
+      case 'b':
+	b->bloom=strtoul(argv[index+1],NULL,10);
+	break;
+      default:
+	error("%s",syntax);
+    }
+  }
+  if(strcmp(b->workload,"seq")!=0&&strcmp(b->workload,"uniform")!=0&&
+     strcmp(b->workload,"zipf")!=0&&strcmp(b->workload,"lookup")!=0&&
+     strcmp(b->workload,"scan")!=0&&strcmp(b->workload,"mixed")!=0)
+    error("%s",syntax);
+  if(b->ops==0||b->read_percent<0||b->read_percent>100||
+     (strcmp(b->mode,"plain")!=0&&strcmp(b->mode,"epsilon")!=0&&
+      strcmp(b->mode,"counted")!=0))
+    error("%s",syntax);
+  return;
+}
+
+/****************************************************************************
+   next_random: A small xorshift generator,so runs repeat exactly on every
+			     C library.
+   -INPUT: None.
+   -OUTPUT: The next pseudo-random number.
+****************************************************************************/
+static unsigned long next_random(void)
+{
+  random_state^=(random_state<<13)&0xFFFFFFFFUL;
+  random_state^=random_state>>17;
+  random_state^=(random_state<<5)&0xFFFFFFFFUL;
+  return random_state&0xFFFFFFFFUL;
+}
+
+/****************************************************************************
+   zipf_key: Draws a key whose rank follows a Zipf distribution.  Ranks
+     are scattered over the key space,so the hot keys are not neighbours.
+   -INPUT: None.
+   -OUTPUT: The key.
+****************************************************************************/
+static word_t zipf_key(void)
+{
+  long low,high,middle;
+  double u;
+
+  u=(double)next_random()/4294967296.0;
+  low=0L,high=KEY_SPACE-1L;
+  while(low<high)  /*the first rank whose cumulative share exceeds u*/
+  {
+    middle=(low+high)/2L;
+    if(zipf_cdf[middle]<u)
+      low=middle+1L;
+    else high=middle;
+  }
+  return (word_t)((low*40503L)%KEY_SPACE);  /*40503 is prime to 65536*/
+}
+
+/****************************************************************************
+   setup_zipf: Computes the cumulative Zipf distribution over the keys.
+   -INPUT: The exponent of the distribution.
+   -OUTPUT: None.
+****************************************************************************/
+static void setup_zipf(double exponent)
+{
+  double sum;
+  long rank;
+
+  if((zipf_cdf=(double *)malloc(KEY_SPACE*sizeof(double)))==NULL)
+    error("%s","Insufficient memory to run program.\n");
+  sum=0.0;
+  for(rank=0;rank<KEY_SPACE;++rank)
+    zipf_cdf[rank]=(sum+=1.0/pow((double)(rank+1),exponent));
+  for(rank=0;rank<KEY_SPACE;++rank)
+    zipf_cdf[rank]/=sum;
+  return;
+}
+
+/****************************************************************************
+   elapsed_ns: The nanoseconds between two readings of the monotonic clock.
+   -INPUT: The earlier and the later reading.
+   -OUTPUT: The difference.
+****************************************************************************/
+static double elapsed_ns(const struct timespec *const start,
+			 const struct timespec *const end)
+{
+  return (double)(end->tv_sec-start->tv_sec)*1e9+
+	 (double)(end->tv_nsec-start->tv_nsec);
+}
+
+/****************************************************************************
+     count_key: The bp_scan() callback of the scan workload.
+   -INPUT: The key and a counter of the keys seen.
+   -OUTPUT: Zero,so that the scan goes on.
+****************************************************************************/
+static int count_key(word_t value,void *arg)
+{
+  (void)value;
+  ++*(unsigned long *)arg;
+  return 0;
+}
+
+static int compare_doubles(const void *a,const void *b)
+{
+  double x=*(const double *)a,y=*(const double *)b;
+
+  return (x<y)?-1:(x>y)?1:0;
+}
+
+/****************************************************************************
+   percentile: Picks a percentile out of sorted latencies.
+   -INPUT: The sorted latencies,their number and the fraction wanted.
+   -OUTPUT: The latency at that fraction.
+****************************************************************************/
+static double percentile(const double *const sorted,unsigned long count,
+			 double fraction)
+{
+  unsigned long index;
+
+  index=(unsigned long)(fraction*(double)count);
+  return sorted[(index<count)?index:count-1];
+}
+
+/****************************************************************************
+   run_bench: Creates a fresh index file,runs the workload and prints the
+			       results.
+   -INPUT: The settings of the run.
+   -OUTPUT: None.
+****************************************************************************/
+static void run_bench(const bench_t *const b)
+{
+  struct timespec start,end,op_start,op_end;
+  unsigned long index,keys_scanned,keys;
+  bp_stats_t before,after;
+  double *latency,total;
+  bp_tree_t *tree;
+  status_t status;
+  word_t value,high;
+  long file_bytes;
+  FILE *iop;
+  int op;
+
+  random_state=(b->seed!=0)?b->seed:1UL;
+  if(strcmp(b->workload,"zipf")==0)
+    setup_zipf(b->zipf_exponent);
+  if((latency=(double *)malloc(b->ops*sizeof(double)))==NULL)
+    error("%s","Insufficient memory to run program.\n");
+  if(strcmp(b->mode,"epsilon")==0)
+    status=bp_create_epsilon(b->name,&tree);
+  else if(strcmp(b->mode,"counted")==0)
+	 status=bp_create_counted(b->name,&tree);
+       else status=bp_create(b->name,&tree);
+  if(status!=SUCCESS)
+    error("%s: %s\n",b->name,bp_strerror(status));
+  if(strcmp(b->workload,"lookup")==0||strcmp(b->workload,"scan")==0||
+     strcmp(b->workload,"mixed")==0)
+    for(index=0;index<b->preload;++index)
+      if((status=bp_insert(tree,(word_t)(next_random()%KEY_SPACE)))!=SUCCESS)
+	error("%s: %s\n",b->name,bp_strerror(status));
+  if(b->memtable>0&&(status=bp_memtable(tree,(size_t)b->memtable))!=SUCCESS)
+    error("%s: %s\n",b->name,bp_strerror(status));
+  if(b->bloom>0&&(status=bp_bloom(tree,(size_t)b->bloom))!=SUCCESS)
+    error("%s: %s\n",b->name,bp_strerror(status));
+
+  keys_scanned=0UL;
+  bp_stats(tree,&before);
+  clock_gettime(CLOCK_MONOTONIC,&start);
+  for(index=0;index<b->ops;++index)
+  {
+    /*pick the operation and its key before the clock starts*/
+    op=*b->workload;
+    value=(word_t)(next_random()%KEY_SPACE);
+    if(op=='s'&&b->workload[1]=='e')  /*seq*/
+      value=(word_t)(index%KEY_SPACE),op='i';
+    else if(op=='u')
+      op='i';
+    else if(op=='z')
+      value=zipf_key(),op='i';
+    else if(op=='m')
+      op=((int)(next_random()%100UL)<b->read_percent)?'l':'i';
+
+    high=(value>WORD_T_MAX-b->scan_length)?(word_t)WORD_T_MAX:
+	 (word_t)(value+b->scan_length);
+
+    clock_gettime(CLOCK_MONOTONIC,&op_start);
+    if(op=='i')
+      status=bp_insert(tree,value);
+    else if(op=='l')
+      status=bp_search(tree,value);
+    else if(*b->mode=='c')  /*counted*/
+	   status=bp_count(tree,value,high,&keys),keys_scanned+=keys;
+	 else status=bp_scan(tree,value,high,count_key,&keys_scanned);
+    clock_gettime(CLOCK_MONOTONIC,&op_end);
+    if(status!=SUCCESS&&status!=E_NOT_FOUND&&status!=E_TREE_EMPTY)
+      error("%s: %s\n",b->name,bp_strerror(status));
+    latency[index]=elapsed_ns(&op_start,&op_end);
+  }
+  if((status=bp_flush(tree))!=SUCCESS)
+    error("%s: %s\n",b->name,bp_strerror(status));
+  clock_gettime(CLOCK_MONOTONIC,&end);
+  bp_stats(tree,&after);
+  if((status=bp_close(tree))!=SUCCESS)
+    error("%s: %s\n",b->name,bp_strerror(status));
+  if((iop=fopen(b->name,"rb"))==NULL||fseek(iop,0L,SEEK_END)!=0||
+     (file_bytes=ftell(iop))<0L)
+    error("Cannot measure index file %s.\n",b->name);
+  fclose(iop);
+
+  total=elapsed_ns(&start,&end);
+  qsort(latency,b->ops,sizeof(double),compare_doubles);
+  fprintf(stdout,"{\"workload\":\"%s\",\"mode\":\"%s\",\"ops\":%lu,"
+	  "\"seed\":%lu,",b->workload,b->mode,b->ops,b->seed);
+  if(strcmp(b->workload,"mixed")==0)
+    fprintf(stdout,"\"read_percent\":%d,",b->read_percent);
+  if(b->memtable>0)
+    fprintf(stdout,"\"memtable\":%lu,",b->memtable);
+  if(b->bloom>0)
+    fprintf(stdout,"\"bloom\":%lu,\"bloom_skips\":%lu,",b->bloom,
+	    after.bloom_skips-before.bloom_skips);
+  if(strcmp(b->workload,"scan")==0)
+    fprintf(stdout,"\"scan_length\":%u,\"keys_per_scan\":%.2f,",
+	    (unsigned int)b->scan_length,(double)keys_scanned/(double)b->ops);
+  fprintf(stdout,"\"seconds\":%.6f,\"ops_per_sec\":%.1f,",total/1e9,
+	  (double)b->ops*1e9/total);
+  fprintf(stdout,"\"latency_ns\":{\"p50\":%.0f,\"p99\":%.0f,\"p999\":%.0f,"
+	  "\"max\":%.0f},",percentile(latency,b->ops,0.50),
+	  percentile(latency,b->ops,0.99),percentile(latency,b->ops,0.999),
+	  latency[b->ops-1]);
+  fprintf(stdout,"\"pages_read_per_op\":%.3f,\"pages_written_per_op\":%.3f,",
+	  (double)(after.total.pages_read-before.total.pages_read)/
+	  (double)b->ops,(double)(after.total.pages_written-
+	  before.total.pages_written)/(double)b->ops);
+  fprintf(stdout,"\"file_bytes\":%ld}\n",file_bytes);
+  free(latency);
+  free(zipf_cdf);
+  return;
+}
@@ -0,0 +1,1007 @@
+/****************************************************************************
+	   b_check.c: Verifies the structure of a B+ tree index file.
+			    Georgios Drakopoulos
+
+   Syntax: b_check [-t threads] <index file>
+
+   The file is mapped into memory,or read into it in large sequential
+   pieces where it cannot be mapped,and every tree in it is walked from
+   its root:the keys of each node in order and inside the range its
+   parent gives it,every child pointing back at its parent,the leaves at
+   one depth,the leaves of a string tree chained in key order,subtree
+   counts,buffered inserts,posting lists and overflow pages.  A node
+   reached twice is reported and not walked again.  Every record reached
+   is entered in a map of the file,which must not overlap itself;what no
+   record takes is reported as dead bytes,the space a compaction would
+   give back.  Values in a value log are not checked.  Besides the file,
+   which a mapping pages in and out as it is walked,the check takes some
+   16 bytes of memory for every record and as many again for every node.
+   Built with -DBP_THREADS and -pthread,the subtrees below the top levels
+   are checked on threads of their own.  The exit status is EXIT_FAILURE
+			     if a check fails.
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L  /*mmap() under a strict -std*/
+
+#include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#if defined(BP_THREADS)
+  #include <pthread.h>
+#endif
+#if defined(__unix__)||defined(__APPLE__)
+  #include <sys/mman.h>
+  #define MAP_FILE_OK 1  /*the file can be mapped instead of read*/
+#endif
+
+#include "b_format.h"
+
+#define READ_SIZE (1L<<20)  /*the bytes of one read of the index file*/
+#define MAX_DEPTH 64  /*a deeper path is taken for a cycle*/
+#define MAX_REPORTS 32  /*the errors a walker describes in full*/
+#define REPORT_SIZE 320  /*the longest line of a report*/
+#define CHECK_UNITS 4  /*subtrees per thread*/
+#define CHECK_THREADS 64  /*the most threads a check uses*/
+
+/*how a walker treats the depth where the subtrees of the threads start*/
+typedef enum { WALK_ALL=0,WALK_SPLIT=1,WALK_TOP=2 } walk_t;
+
+/*a range of the file that a record takes*/
+typedef struct
+{
+  long at;  /*its first byte*/
+  long bytes;  /*its length*/
+} span_t;
+
+/*the keys a subtree may hold:above low and below high in a tree of words,
+  from low on and below high in a string tree*/
+typedef struct
+{
+  boolean_t has_low,has_high;  /*is there a bound?*/
+  word_t low,high;  /*the bounds of a tree of words*/
+  size_t low_length,high_length;  /*and of a string tree*/
+  byte_t low_key[BP_STRING_MAX],high_key[BP_STRING_MAX];
+} bounds_t;
+
+/*a subtree checked apart from the levels above it*/
+typedef struct
+{
+  long block,parent;  /*its root and the parent of its root*/
+  bounds_t bounds;  /*the keys it may hold*/
+  int depth;  /*the depth of its root*/
+  unsigned long keys;  /*the keys found in it*/
+  int leaf_depth;  /*the depth of its leaves,-1 if none was found*/
+  long first_leaf,last_next;  /*its first leaf,and where its last points*/
+} unit_t;
+
+/*the state of a walk over a tree,and what it has found*/
+typedef struct
+{
+  const byte_t *file;  /*the index file*/
+  long size;  /*its bytes*/
+  const header_t *h;  /*the header of the tree*/
+  const char *tree;  /*its name in a catalog file,or NULL*/
+  walk_t mode;  /*how it treats unit_depth*/
+  int unit_depth;  /*where the subtrees of the threads start,or -1*/
+  unit_t *units;  /*those subtrees*/
+  size_t units_used,units_size,next;  /*how many,room and the next one*/
+  int leaf_depth;  /*the depth of the first leaf,-1 before it*/
+  long first_leaf;  /*the first leaf of a string tree,NO_BLOCK before it*/
+  long pending;  /*the next leaf the last one seen points at*/
+  span_t *spans;  /*the records reached*/
+  size_t spans_used,spans_size;  /*how many and room*/
+  long *reached;  /*a hash set of the nodes this walk has entered*/
+  size_t reached_used,reached_size;  /*how many and slots,a power of 2*/
+  unsigned long errors;  /*the checks that failed*/
+  unsigned long nodes,keys,extents,overflows;  /*what was found*/
+  char *log;  /*the reports of the first MAX_REPORTS errors*/
+  size_t log_used,log_size;  /*their bytes and room*/
+} walker_t;
+
+/****************************************************************************
+		      main function-argument parsing
+   -INPUT: The index file name,after the number of threads to check with.
+   -OUTPUT: A symbolic value defined in <stdlib.h>
+****************************************************************************/
+static void read_file(const char *const name,walker_t *const w);
+static void check_catalog(walker_t *const w,int threads);
+static void check_tree(walker_t *const w,const header_t *const h,
+		       const char *const tree,int threads);
+static unsigned long walk_tree(walker_t *const w,long block,long parent,
+			       const bounds_t *const bounds,int depth);
+static void walk_units(walker_t *const w,int threads);
+static void check_spans(walker_t *const w,unsigned long *const dead);
+static void clear_reached(walker_t *const w);
+static boolean_t reach(walker_t *const w,long block);
+static void merge_walker(walker_t *const into,walker_t *const from);
+static void visit(walker_t *const w,long block,long bytes,
+		  unsigned long *const counter);
+static const byte_t *get_record(walker_t *const w,long block,long bytes);
+static void report(walker_t *const w,long block,const char *const format,
+		   ...);
+static void error(const char *const format,...);
+
+int main(int argc,char *argv[]);
+int main(int argc,char *argv[])
+{
+  unsigned long dead;
+  header_t header;
+  int threads;
+  walker_t w;
+
+  threads=1;
+  if(argc==4&&strcmp(argv[1],"-t")==0&&(threads=atoi(argv[2]))>0)
+  {
+    argc-=2;
+    argv+=2;
+  }
+  if(argc!=2)
+    error("%s","Syntax: b_check [-t threads] <index file>\n");
+  if(threads>CHECK_THREADS)
+    threads=CHECK_THREADS;
+  memset(&w,0,sizeof(walker_t));
+  read_file(argv[1],&w);
+  if(w.size<(long)sizeof(header_t))
+    error("%s: The file is too short for a header.\n",argv[1]);
+  memcpy(&header,w.file,sizeof(header_t));
+  visit(&w,0L,(long)sizeof(header_t),NULL);
+  if(header.header_size!=sizeof(header_t))
+    report(&w,0L,"the header says it takes %lu bytes",
+	   (unsigned long)header.header_size);
+  else if(CATALOG(&header))
+  {
+    w.h=&header;
+    check_catalog(&w,threads);
+  }
+  else check_tree(&w,&header,NULL,threads);
+  check_spans(&w,&dead);
+
+  if(w.log_used>0)
+    fwrite(w.log,1,w.log_used,stdout);
+  if(w.errors>MAX_REPORTS)
+    fprintf(stdout,"... and %lu more.\n",w.errors-MAX_REPORTS);
+  fprintf(stdout,"%s: %lu nodes,%lu keys,%lu posting extents,%lu overflow "
+	  "pages,%lu dead bytes of %ld (%.1f%%).\n",argv[1],w.nodes,w.keys,
+	  w.extents,w.overflows,dead,w.size,100.0*(double)dead/(double)w.size);
+  fprintf(stdout,"%s: %lu errors.\n",argv[1],w.errors);
+  return (w.errors==0)?EXIT_SUCCESS:EXIT_FAILURE;
+}
+
+/****************************************************************************
+	error: Prints a message in stderr and quits the program.
+   -INPUT: The error message.
+   -OUTPUT: A symbolic value defined in <stdlib.h>
+****************************************************************************/
+static void error(const char *const format,...)
+{
+  va_list arg_ptr;  /*pointer to argument list*/
+
+  va_start(arg_ptr,format);
+  if(format==NULL)
+    fprintf(stderr,"%s","An unknown error has occured.\n");
+  else vfprintf(stderr,format,arg_ptr);
+  exit(EXIT_FAILURE);
+  va_end(arg_ptr);
+}
+
+/****************************************************************************
+   read_file: Maps the whole index file into memory,read-only,or where it
+     cannot be mapped reads it,READ_SIZE bytes at a time,unbuffered.
+   -INPUT: The file name and the walker to receive the file.
+   -OUTPUT: None.
+****************************************************************************/
+static void read_file(const char *const name,walker_t *const w)
+{
+  byte_t *file;
+  size_t count;
+  FILE *iop;
+  long at;
+
+  if((iop=fopen(name,"rb"))==NULL)
+    error("Cannot open index file %s.\n",name);
+  if(setvbuf(iop,NULL,_IONBF,0)!=0||fseek(iop,0L,SEEK_END)!=0||
+     (w->size=ftell(iop))==-1L||fseek(iop,0L,SEEK_SET)!=0)
+    error("Cannot move within index file %s.\n",name);
+#if defined(MAP_FILE_OK)
+  if(w->size>0&&(file=(byte_t *)mmap(NULL,(size_t)w->size,PROT_READ,
+				     MAP_PRIVATE,fileno(iop),0))!=MAP_FAILED)
+  {
+    fclose(iop);  /*the mapping outlives the stream*/
+    w->file=file;
+    return;
+  }
+#endif
+  if((file=(byte_t *)malloc((size_t)w->size+1))==NULL)
+    error("%s","Insufficient memory to run program.\n");
+  for(at=0L;at<w->size;at+=(long)count)
+  {
+    count=(size_t)((w->size-at<READ_SIZE)?w->size-at:READ_SIZE);
+    if(fread(file+at,1,count,iop)!=count)
+      error("Cannot read from index file %s.\n",name);
+  }
+  fclose(iop);
+  w->file=file;
+  return;
+}
+
+/****************************************************************************
+   check_catalog: Checks the chain of catalog pages of a file of many trees
+		       and every tree they name.
+   -INPUT: The walker,with the header of the file,and the threads.
+   -OUTPUT: None.
+****************************************************************************/
+static void check_catalog(walker_t *const w,int threads)
+{
+  const catalog_entry_t *other;
+  const catalog_t *page;
+  const byte_t *raw;
+  long block,pages;
+  word_t index,seen;
+  size_t length;
+
+  for(block=w->h->root_block,pages=0;block!=NO_BLOCK;
+      block=page->next,++pages)
+  {
+    if(pages>w->size/(long)CATALOG_SIZE)
+    {
+      report(w,block,"%s","the chain of catalog pages loops");
+      return;
+    }
+    if((raw=get_record(w,block,(long)CATALOG_SIZE))==NULL)
+      return;
+    page=(const catalog_t *)raw;
+    if(page->tag!=CATALOG_TAG||page->entries>CATALOG_ENTRIES)
+    {
+      report(w,block,"%s","is not a catalog page");
+      return;
+    }
+    visit(w,block,(long)CATALOG_SIZE,NULL);
+    for(index=0;index<page->entries;++index)
+    {
+      for(length=0;length<CATALOG_NAME&&page->entry[index].name[length]!=0;
+	  ++length)
+	;
+      if(length==0||length==CATALOG_NAME)
+      {
+	report(w,block,"entry %u has no proper name",index);
+	continue;
+      }
+      for(other=page->entry,seen=0;seen<index;++seen,++other)
+	if(strcmp(other->name,page->entry[index].name)==0)
+	  report(w,block,"names tree %s twice",other->name);
+      check_tree(w,&page->entry[index].header,page->entry[index].name,
+		 threads);
+    }
+  }
+  return;
+}
+
+/****************************************************************************
+   check_tree: Checks one tree.  With threads,the top levels are walked
+   first down to a depth with enough subtrees for them,the subtrees are
+   checked on the threads and the top levels are checked last,taking the
+		    counts of each subtree from its thread.
+   -INPUT: The walker,the header of the tree,its name in a catalog file or
+			   NULL and the threads.
+   -OUTPUT: None.
+****************************************************************************/
+static void check_tree(walker_t *const w,const header_t *const h,
+		       const char *const tree,int threads)
+{
+  const header_t *const outer=w->h;
+  const char *const outer_tree=w->tree;
+  bounds_t bounds;
+  int depth;
+
+  w->h=h;
+  w->tree=tree;
+  w->unit_depth=-1;
+  w->units_used=w->next=0;
+  if(h->tree_order<2||h->tree_order>TREE_ORDER||
+     (h->block_size!=sizeof(node_t)&&h->block_size!=PLAIN_BLOCK_SIZE&&
+      h->block_size!=POSTING_BLOCK_SIZE&&h->block_size!=COUNTED_BLOCK_SIZE&&
+      h->block_size!=STRING_PAGE_SIZE))
+    report(w,0L,"the header gives blocks of %lu bytes and order %u",
+	   (unsigned long)h->block_size,h->tree_order);
+  else if(h->root_block!=NO_BLOCK)
+  {
+    memset(&bounds,0,sizeof(bounds_t));
+    if(threads>1)
+      for(w->mode=WALK_SPLIT,depth=1;depth<MAX_DEPTH;++depth)
+      {
+	w->unit_depth=depth;
+	w->units_used=0;
+	clear_reached(w);
+	walk_tree(w,h->root_block,NO_BLOCK,&bounds,0);
+	if(w->units_used==0)  /*the tree is not that deep:split above*/
+	{
+	  w->unit_depth=(depth>1)?depth-1:-1;
+	  clear_reached(w);
+	  if(depth>1)
+	    walk_tree(w,h->root_block,NO_BLOCK,&bounds,0);
+	  break;
+	}
+	if(w->units_used>=(size_t)threads*CHECK_UNITS)
+	  break;
+      }
+    w->mode=WALK_TOP;
+    if(w->unit_depth>0)
+      walk_units(w,threads);
+    w->leaf_depth=-1;
+    w->first_leaf=w->pending=NO_BLOCK;
+    clear_reached(w);
+    walk_tree(w,h->root_block,NO_BLOCK,&bounds,0);
+    if(STRINGS(h)&&w->pending!=NO_BLOCK)
+      report(w,h->root_block,"the last leaf points at block %ld",w->pending);
+  }
+  w->mode=WALK_ALL;
+  w->h=outer;
+  w->tree=outer_tree;
+  return;
+}
+
+/****************************************************************************
+   note_leaf/link_leaves: Check that a leaf is as deep as the first one,
+   and that a run of leaves of a string tree follows the leaf before it.
+   -INPUT: The walker,the leaf and its depth,or the first leaf of the run
+			  and where the last points.
+   -OUTPUT: None.
+****************************************************************************/
+static void note_leaf(walker_t *const w,long block,int depth)
+{
+  if(w->leaf_depth<0)
+    w->leaf_depth=depth;
+  else if(depth!=w->leaf_depth)
+    report(w,block,"is a leaf at depth %d,the first leaf is at %d",depth,
+	   w->leaf_depth);
+  return;
+}
+
+static void link_leaves(walker_t *const w,long first,long next)
+{
+  if(w->first_leaf==NO_BLOCK)
+    w->first_leaf=first;
+  else if(w->pending!=first)
+    report(w,first,"follows a leaf that points at block %ld",w->pending);
+  w->pending=next;
+  return;
+}
+
+/****************************************************************************
+   walk_tree: Checks the subtree of a block,or stops at the depth where the
+   subtrees of the threads start:recording it while the top levels are
+      laid out,taking what the thread found once they are checked.
+   -INPUT: The walker,the block,the block of its parent,the keys it may
+			hold and its depth.
+   -OUTPUT: The keys found in the subtree.
+****************************************************************************/
+static unsigned long walk_node(walker_t *const w,long block,long parent,
+			       const bounds_t *const bounds,int depth);
+static unsigned long walk_page(walker_t *const w,long block,
+			       const bounds_t *const bounds,int depth);
+
+static unsigned long walk_tree(walker_t *const w,long block,long parent,
+			       const bounds_t *const bounds,int depth)
+{
+  unit_t *unit;
+
+  if(depth==w->unit_depth&&w->mode==WALK_SPLIT)
+  {
+    if(w->units_used==w->units_size)
+    {
+      w->units_size=(w->units_size>0)?2*w->units_size:64;
+      if((w->units=(unit_t *)realloc(w->units,
+				     w->units_size*sizeof(unit_t)))==NULL)
+	error("%s","Insufficient memory to run program.\n");
+    }
+    unit=&w->units[w->units_used++];
+    unit->block=block;
+    unit->parent=parent;
+    memcpy(&unit->bounds,bounds,sizeof(bounds_t));
+    unit->depth=depth;
+    return 0UL;
+  }
+  if(depth==w->unit_depth&&w->mode==WALK_TOP)
+  {
+    if(w->next>=w->units_used||w->units[w->next].block!=block)
+      error("%s","The subtrees of the threads are out of step.\n");
+    unit=&w->units[w->next++];
+    if(unit->leaf_depth>=0)
+      note_leaf(w,block,unit->leaf_depth);
+    if(unit->first_leaf!=NO_BLOCK)
+      link_leaves(w,unit->first_leaf,unit->last_next);
+    return unit->keys;
+  }
+  if(depth>=MAX_DEPTH)
+  {
+    report(w,block,"is deeper than %d levels",MAX_DEPTH);
+    return 0UL;
+  }
+  if(reach(w,block)==false)  /*a cycle,or two parents*/
+  {
+    report(w,block,"%s","is reached twice");
+    return 0UL;
+  }
+  if(STRINGS(w->h))
+    return walk_page(w,block,bounds,depth);
+  return walk_node(w,block,parent,bounds,depth);
+}
+
+/****************************************************************************
+   walk_node: Checks a node of a tree of words and the subtrees below it.
+   -INPUT: The walker,the block,the block of its parent,the keys it may
+			hold and its depth.
+   -OUTPUT: The keys found in the subtree.
+****************************************************************************/
+static void walk_postings(walker_t *const w,long head,word_t key);
+
+static unsigned long walk_node(walker_t *const w,long block,long parent,
+			       const bounds_t *const bounds,int depth)
+{
+  const header_t *const h=w->h;
+  unsigned long keys,below;
+  bounds_t inner;
+  const byte_t *raw;
+  word_t index,key;
+  node_t node;
+
+  if((raw=get_record(w,block,(long)h->block_size))==NULL)
+    return 0UL;
+  memset(&node,0,sizeof(node_t));
+  memcpy(&node,raw,h->block_size);
+  if(!BUFFERED(h))
+    node.msgs_used=0;
+  if((node.is_leaf!=true&&node.is_leaf!=false)||
+     node.keys_used>=h->tree_order||node.keys_used==0||
+     node.msgs_used>BUFFER_SIZE)
+  {
+    report(w,block,"is not a node:tag %d,%u keys",(int)node.is_leaf,
+	   node.keys_used);
+    return 0UL;
+  }
+  visit(w,block,(long)h->block_size,&w->nodes);
+  if(node.parent_block!=parent)
+    report(w,block,"points at parent %ld,not %ld",node.parent_block,parent);
+  for(index=0;index<node.keys_used+node.msgs_used;++index)
+  {
+    key=(index<node.keys_used)?node.key[index]:
+	node.msg[index-node.keys_used];
+    if(index>0&&index!=node.keys_used&&key<=((index<node.keys_used)?
+       node.key[index-1]:node.msg[index-node.keys_used-1]))
+      report(w,block,"key %u is out of order",key);
+    if((bounds->has_low==true&&key<=bounds->low)||
+       (bounds->has_high==true&&key>=bounds->high))
+      report(w,block,"key %u is outside the range of its parent",key);
+    if(POSTINGS(h)&&index<node.keys_used&&node.ref[index]!=NO_BLOCK&&
+       w->mode!=WALK_SPLIT)
+      walk_postings(w,node.ref[index],key);
+  }
+  keys=node.keys_used+node.msgs_used;
+  if(w->mode!=WALK_SPLIT)
+    w->keys+=keys;
+  if(node.is_leaf==true)
+  {
+    for(index=0;index<=node.keys_used;++index)
+      if(node.block[index]!=NO_BLOCK)
+      {
+	report(w,block,"is a leaf with a child at block %ld",
+	       node.block[index]);
+	break;
+      }
+    if(node.msgs_used>0)
+      report(w,block,"is a leaf with %u buffered inserts",node.msgs_used);
+    note_leaf(w,block,depth);
+    return keys;
+  }
+  memcpy(&inner,bounds,sizeof(bounds_t));
+  for(index=0;index<=node.keys_used;++index)
+  {
+    if(index>0)
+    {
+      inner.has_low=true;
+      inner.low=node.key[index-1];
+    }
+    inner.has_high=(index<node.keys_used)?true:bounds->has_high;
+    inner.high=(index<node.keys_used)?node.key[index]:bounds->high;
+    below=walk_tree(w,node.block[index],block,&inner,depth+1);
+    if(COUNTED(h)&&w->mode!=WALK_SPLIT&&node.count[index]!=below)
+      report(w,block,"counts %lu keys under child %u,which holds %lu",
+	     node.count[index],index,below);
+    keys+=below;
+  }
+  return keys;
+}
+
+/****************************************************************************
+   walk_page: Checks a page of a string tree,the subtrees below it and the
+		     values of a leaf kept outside it.
+   -INPUT: The walker,the block,the keys it may hold and its depth.
+   -OUTPUT: The keys found in the subtree.
+****************************************************************************/
+static int compare_keys(const byte_t *const a,size_t a_length,
+			const byte_t *const b,size_t b_length);
+static void walk_overflow(walker_t *const w,long block);
+
+static unsigned long walk_page(walker_t *const w,long block,
+			       const bounds_t *const bounds,int depth)
+{
+  byte_t key[BP_STRING_MAX],last[BP_STRING_MAX];
+  const page_t *head;
+  const slot_t *slot;
+  size_t length,last_length;
+  unsigned long keys;
+  const byte_t *raw;
+  bounds_t inner;
+  word_t index;
+
+  if((raw=get_record(w,block,(long)STRING_PAGE_SIZE))==NULL)
+    return 0UL;
+  head=(const page_t *)raw;
+  slot=(const slot_t *)(raw+sizeof(page_t));
+  if((head->is_leaf!=true&&head->is_leaf!=false)||
+     head->slots>STRING_SLOTS||head->prefix>BP_STRING_MAX||
+     head->heap<sizeof(page_t)+head->slots*sizeof(slot_t)||
+     head->heap+head->prefix>STRING_PAGE_SIZE||
+     (head->is_leaf==false&&head->slots==0))
+  {
+    report(w,block,"is not a string page:tag %d,%u keys",(int)head->is_leaf,
+	   head->slots);
+    return 0UL;
+  }
+  visit(w,block,(long)STRING_PAGE_SIZE,&w->nodes);
+  memcpy(key,raw+STRING_PAGE_SIZE-head->prefix,head->prefix);
+  memcpy(&inner,bounds,sizeof(bounds_t));
+  keys=0UL;
+  length=last_length=0;
+  for(index=0;index<=head->slots;++index)
+  {
+    if(index<head->slots)
+    {
+      if(slot[index].offset<head->heap||head->prefix+slot[index].length>
+	 BP_STRING_MAX||(size_t)slot[index].offset+slot[index].length+
+	 slot[index].value>STRING_PAGE_SIZE-head->prefix)
+      {
+	report(w,block,"slot %u lies outside the page",index);
+	return keys;
+      }
+      memcpy(key+head->prefix,raw+slot[index].offset,slot[index].length);
+      length=head->prefix+slot[index].length;
+      if(index>0&&compare_keys(last,last_length,key,length)>=0)
+	report(w,block,"key %u is out of order",index);
+      if((bounds->has_low==true&&
+	  compare_keys(key,length,bounds->low_key,bounds->low_length)<0)||
+	 (bounds->has_high==true&&
+	  compare_keys(key,length,bounds->high_key,bounds->high_length)>=0))
+	report(w,block,"key %u is outside the range of its parent",index);
+      memcpy(last,key,length);
+      last_length=length;
+    }
+    if(head->is_leaf==true)
+    {
+      if(index==head->slots)
+	break;
+      if(slot[index].logged!=0||w->mode==WALK_SPLIT)
+	continue;  /*the value is in the value log*/
+      if(slot[index].value>VALUE_INLINE||
+	 (slot[index].value>0&&slot[index].child!=NO_BLOCK))
+	report(w,block,"key %u has a value of %u bytes in the page",index,
+	       slot[index].value);
+      else if(slot[index].child!=NO_BLOCK)
+	walk_overflow(w,slot[index].child);
+      continue;
+    }
+    if(index<head->slots)  /*the separator bounds the child left of it*/
+    {
+      inner.has_high=true;
+      memcpy(inner.high_key,key,length);
+      inner.high_length=length;
+      if(index==0)
+	keys+=walk_tree(w,head->first,NO_BLOCK,&inner,depth+1);
+      else keys+=walk_tree(w,slot[index-1].child,NO_BLOCK,&inner,depth+1);
+      inner.has_low=true;  /*and the child right of it from below*/
+      memcpy(inner.low_key,key,length);
+      inner.low_length=length;
+    }
+    else
+    {
+      inner.has_high=bounds->has_high;
+      memcpy(inner.high_key,bounds->high_key,bounds->high_length);
+      inner.high_length=bounds->high_length;
+      keys+=walk_tree(w,(head->slots>0)?slot[head->slots-1].child:
+		      head->first,NO_BLOCK,&inner,depth+1);
+    }
+  }
+  if(head->is_leaf==true)
+  {
+    keys=head->slots;
+    if(w->mode!=WALK_SPLIT)
+      w->keys+=keys;
+    note_leaf(w,block,depth);
+    link_leaves(w,block,head->first);
+  }
+  return keys;
+}
+
+/****************************************************************************
+   compare_keys: memcmp() order of two string keys,shorter first on a tie.
+		  -INPUT: The two keys and their lengths.
+		   -OUTPUT: <0,0 or >0,like memcmp().
+****************************************************************************/
+static int compare_keys(const byte_t *const a,size_t a_length,
+			const byte_t *const b,size_t b_length)
+{
+  int result;
+
+  result=memcmp(a,b,(a_length<b_length)?a_length:b_length);
+  if(result!=0)
+    return result;
+  return (a_length<b_length)?-1:(a_length>b_length)?1:0;
+}
+
+/****************************************************************************
+   walk_postings: Checks the extents of a posting list against its first
+   one,which keeps the tail of the list,the number of its ids and the last.
+   -INPUT: The walker,the first extent and the key of the list.
+   -OUTPUT: None.
+****************************************************************************/
+static void walk_postings(walker_t *const w,long head,word_t key)
+{
+  unsigned long ids,id,zigzag;
+  posting_t first,ext;
+  const byte_t *raw;
+  long block,last,count;
+  size_t index;
+  int shift;
+
+  ids=id=0UL;
+  memset(&first,0,sizeof(posting_t));
+  for(block=head,last=NO_BLOCK,count=0;block!=NO_BLOCK;
+      last=block,block=ext.next,++count)
+  {
+    if((raw=get_record(w,block,(long)sizeof(posting_t)))==NULL)
+      return;
+    memcpy(&ext,raw,sizeof(posting_t));
+    if(ext.tag!=POSTING_TAG||ext.used>ext.size||
+       ext.size>(unsigned long)POSTING_LARGEST||
+       get_record(w,block,(long)(sizeof(posting_t)+ext.size))==NULL)
+    {
+      report(w,block,"is not a posting extent of key %u",key);
+      return;
+    }
+    if(block==head&&count==0)
+      memcpy(&first,&ext,sizeof(posting_t));
+    else if(block==head||count>w->size/(long)sizeof(posting_t))
+    {
+      report(w,head,"the posting list of key %u loops",key);
+      return;
+    }
+    visit(w,block,(long)(sizeof(posting_t)+ext.size),&w->extents);
+    for(raw+=sizeof(posting_t),index=0;index<ext.used;++ids)
+    {
+      for(zigzag=0UL,shift=0;shift<(int)(8*sizeof(unsigned long));shift+=7)
+      {
+	zigzag|=(unsigned long)(raw[index]&0x7FU)<<shift;
+	if((raw[index++]&0x80U)==0||index==ext.used)
+	  break;
+      }
+      id=((zigzag&1UL)!=0)?id-((zigzag+1UL)>>1):id+(zigzag>>1);
+    }
+  }
+  if(first.tail!=last)
+    report(w,head,"the posting list of key %u ends at %ld,not at %ld",key,
+	   last,first.tail);
+  if(first.ids!=ids||first.last!=id)
+    report(w,head,"the posting list of key %u holds %lu ids up to %lu,"
+	   "its head says %lu up to %lu",key,ids,id,first.ids,first.last);
+  return;
+}
+
+/****************************************************************************
+   walk_overflow: Checks the overflow pages of a value:each holds its part
+		  and they add up to the length of the value.
+   -INPUT: The walker and the first page.
+   -OUTPUT: None.
+****************************************************************************/
+static void walk_overflow(walker_t *const w,long block)
+{
+  const unsigned long room=STRING_PAGE_SIZE-sizeof(overflow_t);
+  const overflow_t *page;
+  unsigned long length,done;
+  const long first=block;
+  long pages;
+
+  for(length=done=0UL,pages=0;block!=NO_BLOCK;block=page->next,++pages)
+  {
+    if(pages>w->size/(long)STRING_PAGE_SIZE)
+    {
+      report(w,first,"%s","the chain of overflow pages loops");
+      return;
+    }
+    if((page=(const overflow_t *)get_record(w,block,
+					     (long)STRING_PAGE_SIZE))==NULL)
+      return;
+    if(page->tag!=OVERFLOW_TAG||page->used>room||
+       (block!=first&&page->length!=length)||done+page->used>page->length)
+    {
+      report(w,block,"is not the next overflow page of block %ld",first);
+      return;
+    }
+    length=page->length;
+    done+=page->used;
+    visit(w,block,(long)STRING_PAGE_SIZE,&w->overflows);
+  }
+  if(done!=length)
+    report(w,first,"a value of %lu bytes has %lu in its overflow pages",
+	   length,done);
+  return;
+}
+
+/****************************************************************************
+   walk_units: Checks the subtrees below the top levels of a tree,each
+   thread a run of them with a walker of its own,and adds what the walkers
+			  found to the first one.
+   -INPUT: The walker,with the subtrees,and the threads.
+   -OUTPUT: None.
+****************************************************************************/
+typedef struct
+{
+  walker_t w;  /*the walker of the thread*/
+  unit_t *units;  /*its subtrees*/
+  size_t count;  /*how many*/
+} part_t;
+
+static void *walk_part(void *arg)
+{
+  part_t *const part=(part_t *)arg;
+  unit_t *unit;
+  size_t index;
+
+  for(index=0;index<part->count;++index)
+  {
+    unit=&part->units[index];
+    part->w.leaf_depth=-1;
+    part->w.first_leaf=part->w.pending=NO_BLOCK;
+    unit->keys=walk_tree(&part->w,unit->block,unit->parent,&unit->bounds,
+			 unit->depth);
+    unit->leaf_depth=part->w.leaf_depth;
+    unit->first_leaf=part->w.first_leaf;
+    unit->last_next=part->w.pending;
+  }
+  return NULL;
+}
+
+static void walk_units(walker_t *const w,int threads)
+{
+  part_t part[CHECK_THREADS];
+#if defined(BP_THREADS)
+  pthread_t thread[CHECK_THREADS];
+#endif
+  size_t share,next;
+  int index,started;
+
+  share=(w->units_used+(size_t)threads-1)/(size_t)threads;
+  for(started=0,next=0;started<threads&&next<w->units_used;
+      ++started,next+=share)
+  {
+    memset(&part[started].w,0,sizeof(walker_t));
+    part[started].w.file=w->file;
+    part[started].w.size=w->size;
+    part[started].w.h=w->h;
+    part[started].w.tree=w->tree;
+    part[started].w.mode=WALK_ALL;
+    part[started].w.unit_depth=-1;
+    part[started].units=w->units+next;
+    part[started].count=(next+share>w->units_used)?w->units_used-next:share;
+#if defined(BP_THREADS)
+    if(pthread_create(&thread[started],NULL,walk_part,&part[started])!=0)
+      error("%s","Cannot start a thread.\n");
+#else
+    walk_part(&part[started]);
+#endif
+  }
+  for(index=0;index<started;++index)
+  {
+#if defined(BP_THREADS)
+    pthread_join(thread[index],NULL);
+#endif
+    merge_walker(w,&part[index].w);
+  }
+  return;
+}
+
+/****************************************************************************
+     merge_walker: Adds what a walker found to another and frees it.
+   -INPUT: The walker to add to and the walker to add.
+   -OUTPUT: None.
+****************************************************************************/
+static void merge_walker(walker_t *const into,walker_t *const from)
+{
+  size_t index,room;
+
+  for(index=0;index<from->spans_used;++index)
+    visit(into,from->spans[index].at,from->spans[index].bytes,NULL);
+  room=(into->errors<MAX_REPORTS)?into->log_size-into->log_used:0;
+  if(from->log_used>0&&from->log_used>room)
+  {
+    into->log_size=into->log_used+from->log_used;
+    if((into->log=(char *)realloc(into->log,into->log_size))==NULL)
+      error("%s","Insufficient memory to run program.\n");
+  }
+  if(from->log_used>0)
+  {
+    memcpy(into->log+into->log_used,from->log,from->log_used);
+    into->log_used+=from->log_used;
+  }
+  into->errors+=from->errors;
+  into->nodes+=from->nodes;
+  into->keys+=from->keys;
+  into->extents+=from->extents;
+  into->overflows+=from->overflows;
+  free(from->spans);
+  free(from->reached);
+  free(from->log);
+  return;
+}
+
+/****************************************************************************
+   check_spans: Sorts the records reached by where they start and checks
+       that none overlaps the next,adding up the bytes none takes.
+   -INPUT: The walker and a pointer to receive the dead bytes.
+   -OUTPUT: None.
+****************************************************************************/
+static int compare_spans(const void *a,const void *b)
+{
+  const long x=((const span_t *)a)->at,y=((const span_t *)b)->at;
+
+  return (x<y)?-1:(x>y)?1:0;
+}
+
+static void check_spans(walker_t *const w,unsigned long *const dead)
+{
+  size_t index,count;
+  long end;
+
+  qsort(w->spans,w->spans_used,sizeof(span_t),compare_spans);
+  *dead=0UL;
+  count=w->spans_used;
+  for(index=0,end=0L;index<count;++index)
+  {
+    if(index>0&&w->spans[index].at==w->spans[index-1].at)
+      report(w,w->spans[index].at,"%s","is reached twice");
+    else if(w->spans[index].at<end)
+      report(w,w->spans[index].at,"overlaps the record before it,which "
+	     "ends at %ld",end);
+    else *dead+=(unsigned long)(w->spans[index].at-end);
+    if(w->spans[index].at+w->spans[index].bytes>end)
+      end=w->spans[index].at+w->spans[index].bytes;
+  }
+  *dead+=(unsigned long)(w->size-end);
+  return;
+}
+
+/****************************************************************************
+   clear_reached/reach: Empty the set of nodes a walk has entered,and enter
+   a node in it,growing it to keep it at most half full.  Each walk over
+	     a tree and each thread has a set of its own.
+   -INPUT: The walker,and the block of the node.
+   -OUTPUT: None,and false if the node was entered before.
+****************************************************************************/
+static void clear_reached(walker_t *const w)
+{
+  size_t index;
+
+  for(index=0;index<w->reached_size;++index)
+    w->reached[index]=NO_BLOCK;
+  w->reached_used=0;
+  return;
+}
+
+static boolean_t reach(walker_t *const w,long block)
+{
+  unsigned long hash;
+  size_t index,size;
+  long *old;
+
+  if(2*(w->reached_used+1)>w->reached_size)
+  {
+    old=w->reached;
+    size=w->reached_size;
+    w->reached_size=(size>0)?2*size:1024;
+    if((w->reached=(long *)malloc(w->reached_size*sizeof(long)))==NULL)
+      error("%s","Insufficient memory to run program.\n");
+    clear_reached(w);
+    for(index=0;index<size;++index)
+      if(old[index]!=NO_BLOCK)
+	reach(w,old[index]);
+    free(old);
+  }
+  hash=(unsigned long)block;
+  hash=(hash^(hash>>15))*2654435761UL;
+  for(index=(size_t)(hash^(hash>>13))&(w->reached_size-1);
+      w->reached[index]!=NO_BLOCK;index=(index+1)&(w->reached_size-1))
+    if(w->reached[index]==block)
+      return false;
+  w->reached[index]=block;
+  ++w->reached_used;
+  return true;
+}
+
+/****************************************************************************
+   visit: Enters a record in the map of the file,counting it,unless the top
+		       levels are only being laid out.
+   -INPUT: The walker,the block of the record,its bytes and the counter to
+			 add it to,or NULL.
+   -OUTPUT: None.
+****************************************************************************/
+static void visit(walker_t *const w,long block,long bytes,
+		  unsigned long *const counter)
+{
+  if(w->mode==WALK_SPLIT)
+    return;
+  if(w->spans_used==w->spans_size)
+  {
+    w->spans_size=(w->spans_size>0)?2*w->spans_size:1024;
+    if((w->spans=(span_t *)realloc(w->spans,
+				   w->spans_size*sizeof(span_t)))==NULL)
+      error("%s","Insufficient memory to run program.\n");
+  }
+  w->spans[w->spans_used].at=block;
+  w->spans[w->spans_used++].bytes=bytes;
+  if(counter!=NULL)
+    ++*counter;
+  return;
+}
+
+/****************************************************************************
+   get_record: Finds a record in the file,reporting one that does not fit.
+   -INPUT: The walker,the block of the record and its bytes.
+   -OUTPUT: The record,or NULL if it lies outside the file.
+****************************************************************************/
+static const byte_t *get_record(walker_t *const w,long block,long bytes)
+{
+  if(block<(long)sizeof(header_t)||block>w->size-bytes)
+  {
+    report(w,block,"lies outside the file of %ld bytes",w->size);
+    return NULL;
+  }
+  return w->file+block;
+}
+
+/****************************************************************************
+   report: Counts a failed check and describes it,if the walker has not
+   described MAX_REPORTS already.  Nothing is reported while the top
+			  levels are laid out.
+   -INPUT: The walker,the block at fault and a message in printf() style.
+   -OUTPUT: None.
+****************************************************************************/
+static void report(walker_t *const w,long block,const char *const format,
+		   ...)
+{
+  char line[REPORT_SIZE];
+  va_list arg_ptr;
+  size_t length;
+
+  if(w->mode==WALK_SPLIT)
+    return;
+  if(++w->errors>MAX_REPORTS)
+    return;
+  if(w->tree!=NULL)
+    sprintf(line,"tree %.*s,",CATALOG_NAME,w->tree);
+  else *line='\0';
+  length=strlen(line);
+  length+=(size_t)sprintf(line+length,"block %ld: ",block);
+  va_start(arg_ptr,format);
+  length+=(size_t)vsprintf(line+length,format,arg_ptr);
+  va_end(arg_ptr);
+  line[length++]='\n';
+  if(w->log_used+length>w->log_size)
+  {
+    w->log_size=w->log_used+length+MAX_REPORTS*REPORT_SIZE/4;
+    if((w->log=(char *)realloc(w->log,w->log_size))==NULL)
+      error("%s","Insufficient memory to run program.\n");
+  }
+  memcpy(w->log+w->log_used,line,length);
+  w->log_used+=length;
+  return;
+}
@@ -0,0 +1,159 @@
+/****************************************************************************
+     b_format.h: The layout of a B+ tree index file,shared by the engine
+			   and the inspection tools.
+			  Georgios Drakopoulos
+****************************************************************************/
+
+#ifndef B_FORMAT_H
+#define B_FORMAT_H
+
+#include <stddef.h>
+
+#include "b_plus.h"
+
+#define NO_BLOCK -1L  /*value indicating end of path in the tree*/
+
+#define TREE_ORDER 4  /*the order of the B+ tree*/
+#define BUFFER_SIZE 32  /*message slots of a B-epsilon internal node*/
+#define POSTING_TAG 2  /*the is_leaf of a posting extent,which no node has*/
+#define POSTING_FIRST 64  /*the id bytes of the first extent of a list*/
+#define POSTING_LARGEST 65536L  /*extents double in size up to this*/
+
+/*specify the domain and the range of the boolean type*/
+typedef enum { false=0,true=1 } boolean_t;
+
+/*define the structure of a B+ tree node*/
+typedef struct
+{
+  boolean_t is_leaf;  /*is the current node a leaf?*/
+  word_t keys_used;  /*indicates how many keys are used*/
+  word_t key[TREE_ORDER];  /*the keys for the search*/
+  long block[TREE_ORDER+1];  /*the block of the children*/
+  long parent_block;  /*the block of the parent*/
+  long ref[TREE_ORDER];  /*the first posting extent of each key,or NO_BLOCK*/
+  unsigned long count[TREE_ORDER+1];  /*the keys under each child*/
+  word_t msgs_used;  /*buffered inserts,B-epsilon internal nodes only*/
+  word_t msg[BUFFER_SIZE];  /*the buffered inserts in ascending order*/
+} node_t;
+
+/*a plain tree stores a node up to parent_block,so blocks keep the size
+  they had before the extensions;every other tree adds the posting lists
+  of the keys,a counted tree the subtree counts of internal nodes too and
+  a B-epsilon tree stores all of node_t*/
+#define PLAIN_BLOCK_SIZE offsetof(node_t,ref)
+#define POSTING_BLOCK_SIZE offsetof(node_t,count)
+#define COUNTED_BLOCK_SIZE offsetof(node_t,msgs_used)
+#define BUFFERED(h) ((h)->block_size==sizeof(node_t))
+#define COUNTED(h) ((h)->block_size==COUNTED_BLOCK_SIZE)
+#define POSTINGS(h) ((h)->block_size!=PLAIN_BLOCK_SIZE&&!STRINGS(h))
+
+/*the head of an extent of a posting list,followed by size bytes of ids:
+  each id is the zigzag varint of its difference from the previous one*/
+typedef struct
+{
+  int tag;  /*POSTING_TAG,where a node keeps is_leaf*/
+  long next;  /*the next extent of the list,or NO_BLOCK*/
+  long tail;  /*the last extent of the list (first extent only)*/
+  unsigned long size;  /*the bytes of ids the extent has room for*/
+  unsigned long used;  /*the bytes of ids stored in it*/
+  unsigned long last;  /*the last id of the list (first extent only)*/
+  unsigned long ids;  /*the ids in the list (first extent only)*/
+} posting_t;
+
+/*header information for the B+ tree file*/
+typedef struct
+{
+  size_t header_size;  /*the size of the header_t in bytes*/
+  size_t block_size;  /*the size of node_t in bytes*/
+  word_t tree_order;  /*the order of the stored tree*/
+  long root_block;  /*the block of the root*/
+} header_t;
+
+#define CATALOG_NAME 32  /*the bytes of a tree name,its zero included*/
+#define CATALOG_ENTRIES 32  /*the trees a catalog page names*/
+#define CATALOG_TAG 4  /*the is_leaf of a catalog page,which no node has*/
+
+/*a tree of a catalog file:its name and its header,with its root and the
+  size of its blocks,which tells its kind*/
+typedef struct
+{
+  char name[CATALOG_NAME];  /*the name of the tree*/
+  header_t header;  /*where its header would be in a file of its own*/
+} catalog_entry_t;
+
+/*a catalog page.  A file of many trees starts with a header_t whose
+  block_size is CATALOG_SIZE and whose root_block is the first catalog
+  page;the trees share the rest of the file,and a page for more names is
+  appended at the end and chained when the others are full*/
+typedef struct
+{
+  int tag;  /*CATALOG_TAG,where a node keeps is_leaf*/
+  long next;  /*the next catalog page,or NO_BLOCK*/
+  word_t entries;  /*the trees the page names*/
+  catalog_entry_t entry[CATALOG_ENTRIES];
+} catalog_t;
+
+#define CATALOG_SIZE sizeof(catalog_t)
+#define CATALOG(h) ((h)->block_size==CATALOG_SIZE)
+
+#define STRING_PAGE_SIZE 1024  /*the block size of a string tree*/
+#define STRINGS(h) ((h)->block_size==STRING_PAGE_SIZE)
+
+/*the head of a slotted page of a string tree.  The slots follow it and
+  grow up,the key bytes grow down from the end of the page:first the
+  prefix every key of the page shares,stored once,then the rest of each
+  key,followed in a leaf by its value if the value is short.  Keys are in
+  memcmp() order,shorter first on a tie.  An internal page separates its
+  children by keys,each with the child on its right;a leaf holds the keys
+  and the block of the next leaf*/
+typedef struct
+{
+  boolean_t is_leaf;  /*is the page a leaf?*/
+  word_t slots;  /*the keys in the page*/
+  word_t heap;  /*the offset of the lowest key byte*/
+  word_t prefix;  /*the length of the shared prefix*/
+  long first;  /*the leftmost child,or the next leaf (NO_BLOCK at the end)*/
+} page_t;
+
+/*where the rest of a key lies in its page*/
+typedef struct
+{
+  word_t offset;  /*the first byte after the prefix*/
+  word_t length;  /*the bytes after the prefix*/
+  word_t value;  /*the value bytes after the key,0 if it is elsewhere*/
+  word_t logged;  /*is the value in the value log?*/
+  long child;  /*the child right of the key;in a leaf the overflow pages
+		 of the value,or its offset in the value log (NO_BLOCK if
+		 the value is inline)*/
+} slot_t;
+
+/*the most slots a page has room for,keys of no more than the prefix*/
+#define STRING_SLOTS ((STRING_PAGE_SIZE-sizeof(page_t))/sizeof(slot_t))
+
+#define VALUE_INLINE 64  /*longer values of a string tree are not in leaves*/
+#define OVERFLOW_TAG 3  /*the is_leaf of an overflow page,which no page has*/
+
+/*the head of an overflow page,followed by used bytes of a value.  The
+  pages of a value are written in one run at the end of the file*/
+typedef struct
+{
+  int tag;  /*OVERFLOW_TAG,where a page keeps is_leaf*/
+  long next;  /*the next page of the value,or NO_BLOCK*/
+  unsigned long length;  /*the bytes of the whole value*/
+  unsigned long used;  /*the bytes of the value in this page*/
+} overflow_t;
+
+/*the value log of a string tree is a run of segment files <name>.v<n>,
+  and <name>.vlog holds the number of the first one still kept.  Records
+  start in a segment before LOG_SEGMENT bytes,at offset n*LOG_SEGMENT plus
+  their position in it*/
+#define LOG_SEGMENT (1L<<22)
+
+/*a record of a value log,followed by its key and its value*/
+typedef struct
+{
+  unsigned long key_length;  /*the bytes of the key*/
+  unsigned long length;  /*the bytes of the value*/
+} log_record_t;
+
+#endif
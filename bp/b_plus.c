@@ -9,137 +9,57 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
-#include <time.h>
 
-#define MACHINE_16  /*use MACHINE_xx to specify an architecture of xx bits*/
-
-/*define machine-independent unsigned variable types*/
-#if defined(MACHINE_16)  /*proper for PC's*/
-  #define WORD_T_TYPE "%u"  /*input-size modifier for ...printf()*/
-  #define WORD_T_MAX 65535  /*the maximum value of a word_t variable*/
-  #define WORD_T_LSB 0x0001  /*the least significant bit of a word_t value*/
-  typedef unsigned char byte_t;  /*8-bit unsigned quantity*/
-  typedef unsigned int word_t;  /*16-bit unsigned quantity*/
-#elif defined(MACHINE_32)  /*proper for UNIX servers diogenis and zenon*/
-  #define WORD_T_TYPE "%hu"  /*input-size modifier for ...printf()*/
-  #define WORD_T_MAX 65535
-  #define WORD_T_LSB 0x0001
-  typedef unsigned char byte_t;
-  typedef unsigned short word_t;
-#else
-  #error Unsupported architecture or MACHINE_xx not defined.
-#endif
+#include "b_plus.h"
 
 #define FILE_BUFFER_SIZE 128  /*buffer size for file name*/
 #define WORD_BUFFER_SIZE 8  /*buffer size for a word_t variable*/
-
-#define NO_BLOCK -1L  /*value indicating end of path in the tree*/
-
-#define TREE_ORDER 4  /*the order of the B+ tree*/
-
-/*specify the domain and the range of the boolean type*/
-typedef enum { false=0,true=1 } boolean_t;
+#define BATCH_BUFFER_SIZE 65536  /*buffer size for batch keys and results*/
+#define BUILD_MEMORY (1L<<24)  /*bytes of keys build sorts in memory*/
 
 /*specify the available options at the main menu*/
-enum ch { CREATE='1',OPEN='2',CLOSE='3',INSERT='4',SEARCH='5',QUIT='0' };
-
-/*define the structure of a B+ tree node*/
-typedef struct
-{
-  boolean_t is_leaf;  /*is the current node a leaf?*/
-  word_t keys_used;  /*indicates how many keys are used*/
-  word_t key[TREE_ORDER];  /*the keys for the search*/
-  long block[TREE_ORDER+1];  /*the block of the children*/
-  long parent_block;  /*the block of the parent*/
-} node_t;
-
-/*options to initialize the B+ tree*/
-typedef struct
-{
-  char name[FILE_BUFFER_SIZE];  /*buffer that contains the file name*/
-  boolean_t file_exists;  /*true if exists,false if must be created*/
-  FILE *iop;  /*the pointer to B+ tree index file returned by tree_open()*/
-  node_t *p;  /*pointer to current node in memory*/
-} options_t;
+enum ch { CREATE='1',OPEN='2',CLOSE='3',INSERT='4',SEARCH='5',SCAN='6',STATS='7',
+	  QUIT='0' };
 
-/*header information for the B+ tree file*/
+/*a stream of keys or results in batch mode*/
 typedef struct
 {
-  size_t header_size;  /*the size of the header_t in bytes*/
-  size_t block_size;  /*the size of node_t in bytes*/
-  word_t tree_order;  /*the order of the stored tree*/
-  long root_block;  /*the block of the root*/
-} header_t;
-
-typedef enum  /*symbolic names for the various errors*/
-{
-  SUCCESS=0,
-  INV_OPT_PTR=(-1),  /*null pointer to option_t struct*/
-  INV_HEADER_PTR=(-2),  /*null pointer to header_t struct*/
-  INV_DATA_PTR=(-3),  /*null pointer to value*/
-  E_CREATE_FILE=(-4),  /*error while creating index file*/
-  E_OPEN_FILE=(-5),  /*error while opening index file*/
-  E_CLOSE_FILE=(-6),  /*error while closing index file*/
-  E_WRITE_FILE=(-7),  /*error while writing to index file*/
-  E_READ_FILE=(-8),  /*error while reading from index file*/
-  E_MOVE_FILE=(-9),  /*unable to move within the index file*/
-  E_NO_MEMORY=(-10),  /*there is no available memory*/
-  E_TREE_EMPTY=(-11),  /*cannot search an empty tree*/
-  E_INCOMPATIBLE_VERSION=(-12)  /*incompatible version with data*/
-} status_t;
-
-static const char *error_msg[]=
-{
-  "No error occured.",
-  "Null pointer to option struct.",
-  "Null pointer to file header struct.",
-  "Null pointer to tree data.",
-  "Cannot create designated index file.",
-  "Cannot open designated index file.",
-  "Cannot close designated index file.",
-  "Cannot write to designated index file.",
-  "Cannot read from designated index file.",
-  "Cannot move within designated index file.",
-  "Insufficient memory to run program.",
-  "The B+ tree is empty.",
-  "The tree order of the index file is incompatible with the program."
-};
+  FILE *iop;  /*the stream itself*/
+  int binary;  /*nonzero for 16-bit little-endian keys,zero for text*/
+  unsigned long line;  /*the current line of a text stream*/
+  size_t next,used;  /*the unread part of buffer[]*/
+  byte_t buffer[BATCH_BUFFER_SIZE];  /*large reads from the stream*/
+} batch_t;
 
 /****************************************************************************
 			      main function
-			      -input: None.
+   -input: Nothing for the interactive menu,or a batch command:
+	   b_plus load|build|get|scan|count [-b] [-s] [-e|-c] [-t threads]
+				 <index file> [key file]
    -output(to the environemnt): A symbolic value defined in <stdlib.h>.
 ****************************************************************************/
-static status_t insert_value(header_t *h,options_t *opt,word_t value);
-static status_t open_tree(options_t *const opt,header_t *const h);
-static status_t close_tree(options_t *const opt);
-static status_t reallocate_block(options_t *const opt);
-static status_t deallocate_block(options_t *const opt);
-static status_t read_file_name(options_t *const opt);
+static status_t read_file_name(char *const name);
 static status_t read_word_t(word_t *const value);
+static int print_value(word_t value,void *arg);
+static int next_key(word_t *const value,void *arg);
+static void print_stats(FILE *const iop,bp_tree_t *const tree);
+static int run_batch(int argc,char *argv[]);
 static void error(const char *const format,...);
 static void display_menu(void);
 
-int main(void);
-int main(void)
+int main(int argc,char *argv[]);
+int main(int argc,char *argv[])
 {
-  options_t options;  /*initializing options of B+ tree*/
-  header_t header;   /*header of B+ tree*/
+  char name[FILE_BUFFER_SIZE];  /*the name of the current index file*/
+  bp_tree_t *tree;  /*the current index file*/
   status_t status;  /*status indicator returned by last function*/
-  word_t value;
+  word_t value,high;
   int choice;
 
-
-  /*load initial values to both header and options*/
-  options.file_exists=false;
-  options.p=NULL;
-  options.iop=NULL;
-
-  header.tree_order=TREE_ORDER;
-  header.block_size=sizeof(node_t);
-  header.header_size=sizeof(header_t);
-  header.root_block=NO_BLOCK;
-
+  if(argc>1)  /*no menu and no prompts in batch mode*/
+    return run_batch(argc,argv);
+  tree=NULL;
+  *name='\0';
   if(signal(SIGINT,SIG_IGN)==SIG_ERR)  /*ignore Ctrl-C signals*/
     error("%s\n","Unable to install user-defined interrupt handler.");
   fprintf(stdout,"B_PLUS ver 1.00 compiled on %s at %s.\n",__DATE__,__TIME__);
@@ -151,51 +71,75 @@ int main(void)
     switch(choice=getc(stdin))
     {
       case CREATE:
-	close_tree(&options);
-	options.file_exists=false;
-	read_file_name(&options);
-	if((status=reallocate_block(&options))!=SUCCESS)
-	  error("%s\n",error_msg[-status]);
-	if((status=open_tree(&options,&header))!=SUCCESS)
-	  error("%s\n",error_msg[-status]);
-	else fprintf(stderr,"File %s has been created.\n",options.name);
+	bp_close(tree);
+	tree=NULL;
+	read_file_name(name);
+	if((status=bp_create(name,&tree))!=SUCCESS)
+	  error("%s\n",bp_strerror(status));
+	else fprintf(stderr,"File %s has been created.\n",name);
 	break;
       case OPEN:
-	close_tree(&options);
-	options.file_exists=true;
-	read_file_name(&options);
-	if((status=reallocate_block(&options))!=SUCCESS)
-	  error("%s\n",error_msg[-status]);
-	if((status=open_tree(&options,&header))!=SUCCESS)
-	  error("%s\n",error_msg[-status]);
-	else fprintf(stderr,"File %s has been opened.\n",options.name);
+	bp_close(tree);
+	tree=NULL;
+	read_file_name(name);
+	if((status=bp_open(name,&tree))!=SUCCESS)
+	  error("%s\n",bp_strerror(status));
+	else fprintf(stderr,"File %s has been opened.\n",name);
 	break;
       case CLOSE:
-	close_tree(&options);
-	fprintf(stderr,"File %s has been closed.\n",options.name);
+	bp_close(tree);
+	tree=NULL;
+	fprintf(stderr,"File %s has been closed.\n",name);
 	break;
       case INSERT:
-	if(options.iop==NULL)
+	if(tree==NULL)
 	  fprintf(stderr,"%s\n","You must open/create a file first.");
 	else
 	{
 	  if((status=read_word_t(&value))!=SUCCESS)
-	    error("%s\n",error_msg[-status]);
-	  if((status=insert_value(&header,&options,value))!=SUCCESS)
-	    error("%s\n",error_msg[-status]);
+	    error("%s\n",bp_strerror(status));
+	  if((status=bp_insert(tree,value))!=SUCCESS)
+	    error("%s\n",bp_strerror(status));
 	}
 	break;
       case SEARCH:
-	if(options.iop==NULL)
+	if(tree==NULL)
 	  fprintf(stderr,"%s\n","You must open/create a file first.");
 	else
 	{
-	  read_word_t(&value);
+	  if((status=read_word_t(&value))!=SUCCESS)
+	    error("%s\n",bp_strerror(status));
+	  if((status=bp_search(tree,value))==SUCCESS)
+	    fprintf(stdout,"Value "WORD_T_TYPE" found.\n",value);
+	  else if(status==E_NOT_FOUND||status==E_TREE_EMPTY)
+	    fprintf(stdout,"%s\n",bp_strerror(status));
+	  else error("%s\n",bp_strerror(status));
 	}
 	break;
+      case SCAN:
+	if(tree==NULL)
+	  fprintf(stderr,"%s\n","You must open/create a file first.");
+	else
+	{
+	  if((status=read_word_t(&value))!=SUCCESS)
+	    error("%s\n",bp_strerror(status));
+	  if((status=read_word_t(&high))!=SUCCESS)
+	    error("%s\n",bp_strerror(status));
+	  if((status=bp_scan(tree,value,high,print_value,stdout))!=SUCCESS)
+	    error("%s\n",bp_strerror(status));
+	  fputc('\n',stdout);
+	  fflush(stdout);
+	}
+	break;
+      case STATS:
+	if(tree==NULL)
+	  fprintf(stderr,"%s\n","You must open/create a file first.");
+	else print_stats(stdout,tree);
+	break;
       case QUIT:
-	close_tree(&options);
-	fprintf(stderr,"File %s has been closed.\n",options.name);
+	bp_close(tree);
+	tree=NULL;
+	fprintf(stderr,"File %s has been closed.\n",name);
 	break;
       default:
 	fprintf(stderr,"%s\n","Invalid option,try again.");
@@ -203,7 +147,6 @@ int main(void)
     }
   }
   while(choice!=QUIT);
-  deallocate_block(&options);
   return EXIT_SUCCESS;
 }
 
@@ -232,330 +175,341 @@ static void display_menu(void)
 {
   const char menu[]="\n[1] Create new index file.\n[2] Open existing index\
   \bfile.\n[3] Close current index file.\n[4] Insert a value into current i\
-  \b\bndex file.\n[5] Search for a value into current index file.\n[0] Qui\
-  \b\bt program.\n\nYour choice:";
+  \b\bndex file.\n[5] Search for a value into current index file.\n[6] Sca\
+  \b\bn a range of the current index file.\n[7] Show the I/O statistics o\
+  \b\bf the current index file.\n[0] Quit program.\n\nYour choice:";
   fprintf(stdout,"%s",menu);
   fflush(stdout);
   return;
 }
 
 /****************************************************************************
- reallocate_block: Reserves memory for one node (which fits to a disk block)
-	of a B+ tree or resizes it to fit current tree's block size.
-	  -input: A constant pointer to the B+ tree's options.
-	-output: A status_t value indicating success or an error.
+	  print_value: Prints one key found by bp_scan().
+	 -input: The key and the stream to print it to.
+	     -output: Zero,so that the scan goes on.
 ****************************************************************************/
-static status_t reallocate_block(options_t *const opt)
+static int print_value(word_t value,void *arg)
 {
-  if(opt==NULL)
-    return INV_OPT_PTR;
-  if((opt->p=(node_t *)realloc(opt->p,sizeof(node_t)))==NULL)
-    return E_NO_MEMORY;
+  fprintf((FILE *)arg,WORD_T_TYPE " ",value);
+  return 0;
+}
+
+/****************************************************************************
+	 read_file_name: Reads the index file name from stdin.
+   -input: A buffer of FILE_BUFFER_SIZE characters for the file name.
+	 -output: A status_t value indicating sucess or an error.
+****************************************************************************/
+static status_t read_file_name(char *const name)
+{
+  size_t last_char_index;
+  if(name==NULL)
+    return INV_DATA_PTR;
+  do
+  {
+    fprintf(stdout,"%s","Enter index file name:");
+    fflush(stdout);
+    fflush(stdin);
+  }
+  while(!fgets(name,FILE_BUFFER_SIZE,stdin)||isspace((int)*name));
+  if(name[last_char_index=(strlen(name)-1)]=='\n')
+    name[last_char_index]='\0';
   return SUCCESS;
 }
 
 /****************************************************************************
-   deallocate_block: Deallocates the memory reserved from allocate_block().
-	    -input: A constant pointer to the B+ tree's options.
-	  -output: A status_t value indicating sucess or an error.
+	read_word_t: Reads a word_t value (in decimal) from stdin.
+	       -input: A constant pointer to a word_t variable.
+	    -output: A status_t value indicating success or an error.
 ****************************************************************************/
-static status_t deallocate_block(options_t *const opt)
+static status_t read_word_t(word_t *const value)
 {
-  if(opt==NULL)
-    return INV_OPT_PTR;
-  if(opt->p!=NULL)
-    free(opt->p);
-  opt->p=NULL;
+  char buffer[WORD_BUFFER_SIZE];
+  if(value==NULL)
+    return INV_DATA_PTR;
+  do
+    do
+    {
+      fprintf(stdout,"Enter the value (0-"WORD_T_TYPE"):",WORD_T_MAX);
+      fflush(stdout);
+      fflush(stdin);
+    }
+    while(!fgets(buffer,WORD_BUFFER_SIZE,stdin)||isspace((int)*buffer));
+  while(sscanf(buffer,WORD_T_TYPE,value)!=1);
   return SUCCESS;
 }
 
 /****************************************************************************
-	    open_tree: Opens/constructs the B+ tree in the disk.
-  -input: A constant pointer to B+ tree's options and a constant pointer to
-			    the B+ tree's header.
-	  -output: A status_t value indicating sucess or an error.
+     read_key: Returns the next key of a batch stream.  Text keys are
+   decimal numbers separated by white space,binary keys are 16-bit little
+			      endian words.
+     -input: A constant pointer to the batch stream and to the key.
+	  -output: 1 for a key,0 at the end of the stream or -1 for
+			   malformed input.
 ****************************************************************************/
-static status_t open_tree(options_t *const opt,header_t *const h)
+static int fill_batch(batch_t *const in);
+
+static int read_key(batch_t *const in,word_t *const value)
 {
-  if(opt==NULL)
-    return INV_OPT_PTR;
-  if(h==NULL)
-    return INV_HEADER_PTR;
-  if(opt->file_exists==true)
+  unsigned long number;
+  int digits;
+
+  if(in->binary!=0)
   {
-    if((opt->iop=fopen(opt->name,"r+b"))==NULL)
-      return E_OPEN_FILE;
-    if(fread(h,sizeof(header_t),1,opt->iop)!=1)
-      return E_READ_FILE;
+    while(in->used-in->next<2)
+      if(fill_batch(in)==0)
+	return (in->next==in->used)?0:-1;
+    *value=(word_t)(in->buffer[in->next]|(in->buffer[in->next+1]<<8));
+    in->next+=2;
+    return 1;
   }
-  else
+  for(;;)  /*skip the separators*/
   {
-    if((opt->iop=fopen(opt->name,"w+b"))==NULL)
-      return E_CREATE_FILE;
-    if(fwrite(h,sizeof(header_t),1,opt->iop)!=1)
-      return E_WRITE_FILE;
-    fflush(opt->iop);
+    if(in->next==in->used&&fill_batch(in)==0)
+      return 0;
+    if(!isspace((int)in->buffer[in->next]))
+      break;
+    if(in->buffer[in->next++]=='\n')
+      ++in->line;
   }
-  return SUCCESS;
+  number=0UL;
+  digits=0;
+  while((in->next<in->used||fill_batch(in)!=0)&&
+	isdigit((int)in->buffer[in->next]))
+  {
+    number=number*10UL+(unsigned long)(in->buffer[in->next++]-'0');
+    if(number>WORD_T_MAX)
+      return -1;
+    ++digits;
+  }
+  if(digits==0||(in->next<in->used&&!isspace((int)in->buffer[in->next])))
+    return -1;
+  *value=(word_t)number;
+  return 1;
 }
 
 /****************************************************************************
-	      close_tree: Closes a file containing a B+ tree.
-	   -input: A constant pointer to the B+ tree's options.
-	 -output: A status_t value indicating sucess or an error.
+   fill_batch: Moves the unread bytes of a batch stream to the front of its
+	       buffer and refills the rest with one large read.
+		-input: A constant pointer to the batch stream.
+	   -output: The number of bytes that were read.
 ****************************************************************************/
-static status_t close_tree(options_t *const opt)
+static int fill_batch(batch_t *const in)
 {
-  if(opt==NULL)
-    return INV_OPT_PTR;
-  if(opt->iop!=NULL&&fclose(opt->iop)==EOF)
-    return E_CLOSE_FILE;
-  opt->iop=NULL;  /*just a precaution*/
-  return SUCCESS;
+  size_t count;
+
+  memmove(in->buffer,in->buffer+in->next,in->used-in->next);
+  in->used-=in->next;
+  in->next=0;
+  count=fread(in->buffer+in->used,1,BATCH_BUFFER_SIZE-in->used,in->iop);
+  in->used+=count;
+  return (int)count;
 }
 
 /****************************************************************************
-		insert_value: Inserts a value in B+ tree.
- -input: A pointer to the B+ tree's header,a pointer to the B+ tree's options
-	       and a word_t variable (the value to be inserted).
-	   -output: A status_t value indicating sucess or an error.
+   next_key: Reads the next key of a batch input stream for bp_load().
+	-input: A pointer to receive the key and the batch stream.
+	    -output: 1 for a key,0 at the end,-1 for a malformed key.
 ****************************************************************************/
-static status_t node_overflow(options_t *const opt,header_t *const h);
-
-static status_t insert_value(header_t *h,options_t *opt,word_t value)
+static int next_key(word_t *const value,void *arg)
 {
-  word_t index,new_pos;
-  boolean_t insert;
+  return read_key((batch_t *)arg,value);
+}
 
-  if(h==NULL)
-    return INV_HEADER_PTR;
-  if(opt==NULL)
-    return INV_OPT_PTR;
-  if(value==NULL)
-    return INV_DATA_PTR;
-  if(h->tree_order>TREE_ORDER)
-    return E_INCOMPATIBLE_VERSION;
-  if(h->root_block==NO_BLOCK)  /*the tree is initially empty*/
-  {
-    if(fseek(opt->iop,0L,SEEK_SET)!=0)
-      return E_MOVE_FILE;
-    h->root_block=(unsigned long)h->header_size;
-    if(fwrite(h,sizeof(header_t),1,opt->iop)!=1)
-      return E_WRITE_FILE;
-    fflush(opt->iop);
+/****************************************************************************
+	write_key: Writes one key to the batch output stream.
+     -input: The key and a constant pointer to the batch output stream.
+		      -output: Zero,so that a scan goes on.
+****************************************************************************/
+static int write_key(word_t value,void *arg)
+{
+  batch_t *const out=(batch_t *)arg;
 
-    /*initialize root node*/
-    opt->p->key[0]=value;
-    opt->p->keys_used=1;
-    opt->p->parent_block=NO_BLOCK;
-    opt->p->is_leaf=false;
-    for(index=0;index<=h->tree_order;++index)  /*(tree_order+1) blocks*/
-      opt->p->block[index]=NO_BLOCK;
-    if(fwrite(opt->p,h->block_size,1,opt->iop)!=1)
-      return E_WRITE_FILE;
-    fflush(opt->iop);
-  }
-  else
+  if(out->binary!=0)
   {
-    fseek(opt->iop,h->root_block,SEEK_SET); /*go to the root*/
-    insert=false;
-    while(insert==false)
-    {
-      fread(opt->p,h->block_size,1,opt->iop);
-      /*search for the first entry q in node that value<=q*/
-      for(new_pos=0;new_pos<opt->p->keys_used;++new_pos)
-	if(value<=opt->p->key[new_pos])
-	  break;
-      if(value==opt->p->key[new_pos])
-	insert=true;  /*value exists*/
-      else if(opt->p->block[new_pos+1]==NO_BLOCK)  /*no more path to follow*/
-	   {
-	     ++(opt->p->keys_used);
-	     for(index=opt->p->keys_used-1;index>new_pos;--index)
-	       opt->p->key[index]=opt->p->key[index-1];
-	     opt->p->key[new_pos]=value;
-	     for(index=opt->p->keys_used;index>new_pos;--index)
-	       opt->p->block[index]=opt->p->block[index-1];
-	     opt->p->block[new_pos+1]=NO_BLOCK;
-	     fseek(opt->iop,-(long)h->block_size,SEEK_CUR);
-	     fwrite(opt->p,h->block_size,1,opt->iop);
-	     if(opt->p->keys_used==h->tree_order)
-	       node_overflow(opt,h);
-	     insert=true;  /*value successfully inserted into the tree*/
-	   }
-	   else  /*the path continues*/
-	   {
-	     fseek(opt->iop,opt->p->block[new_pos+1],SEEK_SET);
-	   }
-    }
+    putc((int)(value&0xFFU),out->iop);
+    putc((int)((value>>8)&0xFFU),out->iop);
   }
-  return SUCCESS;
+  else fprintf(out->iop,WORD_T_TYPE "\n",value);
+  return 0;
 }
 
 /****************************************************************************
-	   node_overflow: Implements the overflow in a B+ tree.
-  -input: A constant pointer to the B+ tree's options and a constant pointer
-		      to the B+ tree's file header.
-       -output: A status_t value indicating success or an error
+  run_batch: Runs one command over a whole stream of keys,without a menu or
+   prompts.  load inserts every key,creating the index file if needed.
+   build does the same through an external sort and a bottom-up build,
+   which suits a large unsorted dump loaded into a new file;-t spreads
+   the build over threads,if the library was built with BP_THREADS.
+   get answers every key with "<key> 1" or "<key> 0" (one byte in binary
+   mode).  scan reads pairs of bounds and writes the keys of each range,
+   count reads pairs of bounds and writes "<low> <high> <keys>" for each
+   (a 32-bit little-endian number in binary mode).  -s prints the I/O
+   statistics of the run to stderr at the end.  -e makes load create a
+   missing index file in B-epsilon mode,-c a counted one,for which count
+			     costs two descents.
+	       -input: The command line arguments of main().
+   -output(to the environemnt): A symbolic value defined in <stdlib.h>.
 ****************************************************************************/
-static status_t node_overflow(options_t *const opt,header_t *const h)
+static int run_batch(int argc,char *argv[])
 {
-  word_t q,left_keys,right_keys,index,new_pos;
-  long par_block,left_block,right_block;
-  static boolean_t initialized=false;
-  long temp_block[TREE_ORDER+1];
-  word_t temp_key[TREE_ORDER];
-  boolean_t overflow;
-
-  if(initialized==false)
+  static batch_t in,out;  /*too large for the stack of a PC*/
+  const char *command,*name;
+  unsigned long keys;
+  word_t value,high;
+  bp_tree_t *tree;
+  status_t status;
+  int read,stats,epsilon,counted,threads;
+
+  command=argv[1];
+  in.binary=stats=epsilon=counted=0;
+  threads=1;
+  for(;argc>2&&*argv[2]=='-';--argc,++argv)
+    if(strcmp(argv[2],"-b")==0)
+      in.binary=1;
+    else if(strcmp(argv[2],"-s")==0)
+      stats=1;
+    else if(strcmp(argv[2],"-e")==0)
+      epsilon=1;
+    else if(strcmp(argv[2],"-c")==0)
+      counted=1;
+    else if(strcmp(argv[2],"-t")==0&&argc>3&&(threads=atoi(argv[3]))>0)
+    {
+      --argc;
+      ++argv;
+    }
+    else argc=0;  /*an unknown option*/
+  out.binary=in.binary;
+  if(argc<3||argc>4||epsilon+counted>1||
+     (strcmp(command,"load")!=0&&strcmp(command,"build")!=0&&
+      strcmp(command,"get")!=0&&strcmp(command,"scan")!=0&&
+      strcmp(command,"count")!=0))
+    error("%s","Syntax: b_plus load|build|get|scan|count [-b] [-s] [-e|-c] "
+	  "[-t threads] <index file> [key file]\n");
+  name=argv[2];
+  if(argc==4)
   {
-    srand((unsigned int)(time(NULL)%RAND_MAX));
-    initialized=true;
+    if((in.iop=fopen(argv[3],(in.binary!=0)?"rb":"r"))==NULL)
+      error("Cannot open key file %s.\n",argv[3]);
   }
-  q=(rand()>(RAND_MAX>>1U))?(word_t)0:(word_t)1;
-  left_keys=(h->tree_order>>1U)-q;
-  right_keys=(h->tree_order>>1U)+q-1;
-  overflow=true;
-  while(overflow==true)
+  else in.iop=stdin;
+  in.line=1UL;
+  in.next=in.used=0;
+  out.iop=stdout;
+  if(setvbuf(stdout,NULL,_IOFBF,BATCH_BUFFER_SIZE)!=0)
+    error("%s\n","Cannot set up the output buffer.");
+
+  status=bp_open(name,&tree);
+  if(status==E_OPEN_FILE&&(*command=='l'||*command=='b'))
+    status=(epsilon!=0)?bp_create_epsilon(name,&tree):
+	   (counted!=0)?bp_create_counted(name,&tree):bp_create(name,&tree);
+  if(status!=SUCCESS)
+    error("%s: %s\n",name,bp_strerror(status));
+  read=0;
+  if(*command=='b'&&  /*build*/
+     (status=bp_load(tree,next_key,&in,BUILD_MEMORY,threads))==E_KEY_SOURCE)
   {
-    if(opt->p->parent_block==NO_BLOCK)  /*if the root must break*/
-    {
-      for(index=0;index<opt->p->keys_used;++index)
-	temp_key[index]=opt->p->key[index];
-      for(index=0;index<=opt->p->keys_used;++index)
-	temp_block[index]=opt->p->block[index];
-
-      /*write left son*/
-      opt->p->parent_block=(unsigned long)h->header_size;
-      opt->p->keys_used=left_keys;
-      for(index=0;index<left_keys;++index)
-	opt->p->key[index]=temp_key[index];
-      for(index=0;index<=left_keys;++index)
-	opt->p->block[index]=temp_block[index];
-      fseek(opt->iop,0L,SEEK_END);
-      par_block=left_block=ftell(opt->iop);
-      fwrite(opt->p,h->block_size,1,opt->iop);
-      fflush(opt->iop);
-
-      for(index=0;index<=opt->p->keys_used;++index)
-      {
-	fseek(opt->iop,opt->p->block[index],SEEK_SET);
-	fread(opt->p,h->block_size,1,opt->iop);
-	opt->p->parent_block=par_block;
-	fseek(opt->iop,-(long)h->block_size,SEEK_CUR);
-	fwrite(opt->p,h->block_size,1,opt->iop);
-      }
-
-      /*write right son*/
-      opt->p->keys_used=right_keys;
-      for(index=left_keys+1;index<h->tree_order;++index)
-	opt->p->key[index-left_keys-1]=temp_key[index];
-      for(index=left_keys+1;index<=h->tree_order;++index)
-	opt->p->block[index-left_keys-1]=temp_block[index];
-      par_block=right_block=ftell(opt->iop);
-      fwrite(opt->p,h->block_size,1,opt->iop);
-      fflush(opt->iop);
-
-      for(index=0;index<=opt->p->keys_used;++index)
-      {
-	fseek(opt->iop,opt->p->block[index],SEEK_SET);
-	fread(opt->p,h->block_size,1,opt->iop);
-	opt->p->parent_block=par_block;
-	fseek(opt->iop,-(long)h->block_size,SEEK_CUR);
-	fwrite(opt->p,h->block_size,1,opt->iop);
-      }
-
-      /*rewrite the root node*/
-      fseek(opt->iop,(unsigned long)h->header_size,SEEK_SET);
-      fread(opt->p,h->block_size,1,opt->iop);
-      opt->p->keys_used=1,opt->p->parent_block=NO_BLOCK;
-      opt->p->key[0]=temp_key[left_keys];
-      opt->p->block[0]=left_block,opt->p->block[1]=right_block;
-      fseek(opt->iop,-(long)h->block_size,SEEK_CUR);
-      fwrite(opt->p,h->block_size,1,opt->iop);
-      fflush(opt->iop);
-
-      overflow=false; /*the root has been broken*/
-    }
-    else
+    read=-1;
+    status=SUCCESS;
+  }
+  while(*command!='b'&&status==SUCCESS&&(read=read_key(&in,&value))==1)
+    switch(*command)
     {
-       for(index=left_keys;index<opt->p->keys_used;++index)
-	 temp_key[index]=opt->p->key[index];
-       for(index=left_keys;index<=opt->p->keys_used;++index)
-	 temp_block[index]=opt->p->block[index];
-       opt->p->keys_used=left_keys;
-       fseek(opt->iop,-(long)h->block_size,SEEK_CUR);
-       left_block=ftell(opt->iop);
-       fwrite(opt->p,h->block_size,1,opt->iop);
-       fseek(opt->iop,0L,SEEK_END);
-       right_block=ftell(opt->iop);
-       for(index=1;index<=right_keys;++index)
-	 opt->p->key[index-1]=temp_key[index];
-       for(index=0;index<=right_keys;++index)
-	 opt->p->block[index]=temp_block[index];
-       opt->p->keys_used=right_keys;
-       fwrite(opt->p,h->block_size,1,opt->iop);
-       fseek(opt->iop,opt->p->parent_block,SEEK_SET);
-       fread(opt->p,h->block_size,1,opt->iop);
-       for(new_pos=0;new_pos<opt->p->keys_used;++new_pos)
-	 if(*temp_key<opt->p->key[new_pos])
-	   break;
-       ++(opt->p->keys_used);
-       for(index=opt->p->keys_used-1;index>new_pos;--index)
-	 opt->p->key[index]=opt->p->key[index-1];
-      opt->p->key[new_pos]=*temp_key;
-      for(index=opt->p->keys_used;index>new_pos;--index)
-	 opt->p->block[index]=opt->p->block[index-1];
-      opt->p->block[new_pos+1]=right_block;
-      fseek(opt->iop,-(long)h->block_size,SEEK_CUR);
-      fwrite(opt->p,h->block_size,1,opt->iop);
-      if(opt->p->keys_used<h->tree_order)
-	overflow=false;
+      case 'l':  /*load*/
+	status=bp_insert(tree,value);
+	break;
+      case 'g':  /*get*/
+	if((status=bp_search(tree,value))==E_NOT_FOUND||status==E_TREE_EMPTY)
+	  status=E_NOT_FOUND;
+	if(out.binary!=0)
+	  putc((status==SUCCESS)?1:0,stdout);
+	else fprintf(stdout,WORD_T_TYPE " %d\n",value,(status==SUCCESS)?1:0);
+	if(status==E_NOT_FOUND)
+	  status=SUCCESS;
+	break;
+      case 'c':  /*count*/
+	if((read=read_key(&in,&high))!=1)
+	{
+	  read=-1;  /*a lower bound without an upper one*/
+	  break;
+	}
+	if((status=bp_count(tree,value,high,&keys))!=SUCCESS)
+	  break;
+	if(out.binary!=0)
+	  for(read=0;read<4;++read,keys>>=8)
+	    putc((int)(keys&0xFFUL),stdout);
+	else fprintf(stdout,WORD_T_TYPE " " WORD_T_TYPE " %lu\n",value,high,
+		     keys);
+	read=1;
+	break;
+      default:  /*scan*/
+	if((read=read_key(&in,&high))!=1)
+	{
+	  read=-1;  /*a lower bound without an upper one*/
+	  break;
+	}
+	status=bp_scan(tree,value,high,write_key,&out);
+	break;
     }
-  }
-  return SUCCESS;
+  if(status!=SUCCESS)
+    error("%s: %s\n",name,bp_strerror(status));
+  if(read<0)
+    error("Malformed key at line %lu.\n",in.line);
+  if(in.iop!=stdin)
+    fclose(in.iop);
+  if(stats!=0)
+    print_stats(stderr,tree);
+  if((status=bp_close(tree))!=SUCCESS)
+    error("%s: %s\n",name,bp_strerror(status));
+  if(fflush(stdout)==EOF)
+    error("%s\n","Cannot write the results.");
+  return EXIT_SUCCESS;
 }
 
 /****************************************************************************
-	 read_file_name: Reads the index file name from stdin.
-	  -input: A constant pointer to the B+ tree's options.
-	 -output: A status_t value indicating sucess or an error.
+   print_stats: Prints the I/O counters of an index file by operation,the
+       splits by level and the figures worth watching:bytes written per
+	inserted key,against the size of the key,and nodes read per lookup,
+			followed by the latency histograms.
+	   -input: The stream to print to and the tree handle.
+			      -output: None.
 ****************************************************************************/
-static status_t read_file_name(options_t *const opt)
+static void print_stats(FILE *const iop,bp_tree_t *const tree)
 {
-  size_t last_char_index;
-  if(opt==NULL)
-    return INV_OPT_PTR;
-  do
+  static const char *const op_name[BP_OPS+1]=
+    { "insert","search","scan","other","total" };
+  const bp_io_t *io;
+  bp_latency_t lat;
+  bp_stats_t stats;
+  int index;
+
+  if(bp_stats(tree,&stats)!=SUCCESS||bp_latency(tree,&lat)!=SUCCESS)
+    return;
+  fprintf(iop,"%-8s%10s%12s%12s%14s%10s%10s%10s%10s\n","","calls","pages read",
+	  "pages wrtn","bytes wrtn","seeks","flushes","hits","misses");
+  for(index=0;index<=BP_OPS;++index)
   {
-    fprintf(stdout,"%s","Enter index file name:");
-    fflush(stdout);
-    fflush(stdin);
+    io=(index<BP_OPS)?&stats.op[index]:&stats.total;
+    fprintf(iop,"%-8s%10lu%12lu%12lu%14lu%10lu%10lu%10lu%10lu\n",
+	    op_name[index],io->calls,io->pages_read,io->pages_written,
+	    io->bytes_written,io->seeks,io->flushes,io->cache_hits,
+	    io->cache_misses);
   }
-  while(!fgets(opt->name,FILE_BUFFER_SIZE,stdin)||isspace((int)*opt->name));
-  if(opt->name[last_char_index=(strlen(opt->name)-1)]=='\n')
-    opt->name[last_char_index]='\0';
-  return SUCCESS;
-}
-
-/****************************************************************************
-	read_word_t: Reads a word_t value (in decimal) from stdin.
-	       -input: A constant pointer to a word_t variable.
-	    -output: A status_t value indicating success or an error.
-****************************************************************************/
-static status_t read_word_t(word_t *const value)
-{
-  char buffer[WORD_BUFFER_SIZE];
-  if(value==NULL)
-    return INV_DATA_PTR;
-  do
-    do
-    {
-      fprintf(stdout,"Enter the value (0-"WORD_T_TYPE"):",WORD_T_MAX);
-      fflush(stdout);
-      fflush(stdin);
-    }
-    while(!fgets(buffer,WORD_BUFFER_SIZE,stdin)||isspace((int)*buffer));
-  while(sscanf(buffer,WORD_T_TYPE,value)!=1);
-  return SUCCESS;
+  fprintf(iop,"%s","splits by level:");
+  for(index=0;index<BP_SPLIT_LEVELS;++index)
+    if(stats.splits[index]!=0)
+      fprintf(iop," %d:%lu",index,stats.splits[index]);
+  fputc('\n',iop);
+  io=&stats.op[BP_OP_INSERT];
+  if(io->calls!=0)
+    fprintf(iop,"write amplification: %.2f\n",(double)io->bytes_written/
+	    ((double)io->calls*(double)sizeof(word_t)));
+  io=&stats.op[BP_OP_SEARCH];
+  if(io->calls!=0)
+    fprintf(iop,"pages read per lookup: %.2f\n",
+	    (double)io->pages_read/(double)io->calls);
+  if(stats.bloom_skips!=0)
+    fprintf(iop,"lookups answered by the Bloom filter: %lu\n",
+	    stats.bloom_skips);
+  bp_latency_print(iop,&lat);
+  fflush(iop);
+  return;
 }
@@ -0,0 +1,258 @@
+/****************************************************************************
+	     b_plus.h: The public interface of the B+ tree library.
+			  Georgios Drakopoulos
+
+   The engine in b_tree.c builds as a static or a shared library:
+	cc -c b_tree.c && ar rcs libbplus.a b_tree.o
+	cc -shared -fPIC -o libbplus.so b_tree.c
+   and programs link against it with -lbplus.  Adding -DBP_TRACE builds in
+   static tracepoints for perf and bpftrace (provider bplus:page_read,
+   page_write,cache_hit,cache_miss,descend,split_start,split_done,
+   root_split and flush),which cost a no-op each until a tracer attaches;
+   it needs <sys/sdt.h> from systemtap-sdt-dev.  Adding -DBP_THREADS and
+   -pthread lets bp_build() spread its work over threads;without it the
+   build runs on one and writes the same file.  Every call returns a
+   status_t value;bp_strerror() turns it into a message.
+****************************************************************************/
+
+#ifndef B_PLUS_H
+#define B_PLUS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define MACHINE_16  /*use MACHINE_xx to specify an architecture of xx bits*/
+
+/*define machine-independent unsigned variable types*/
+#if defined(MACHINE_16)  /*proper for PC's*/
+  #define WORD_T_TYPE "%u"  /*input-size modifier for ...printf()*/
+  #define WORD_T_MAX 65535  /*the maximum value of a word_t variable*/
+  #define WORD_T_LSB 0x0001  /*the least significant bit of a word_t value*/
+  typedef unsigned char byte_t;  /*8-bit unsigned quantity*/
+  typedef unsigned int word_t;  /*16-bit unsigned quantity*/
+#elif defined(MACHINE_32)  /*proper for UNIX servers diogenis and zenon*/
+  #define WORD_T_TYPE "%hu"  /*input-size modifier for ...printf()*/
+  #define WORD_T_MAX 65535
+  #define WORD_T_LSB 0x0001
+  typedef unsigned char byte_t;
+  typedef unsigned short word_t;
+#else
+  #error Unsupported architecture or MACHINE_xx not defined.
+#endif
+
+typedef enum  /*symbolic names for the various errors*/
+{
+  SUCCESS=0,
+  INV_OPT_PTR=(-1),  /*null pointer to option_t struct*/
+  INV_HEADER_PTR=(-2),  /*null pointer to header_t struct*/
+  INV_DATA_PTR=(-3),  /*null pointer to value*/
+  E_CREATE_FILE=(-4),  /*error while creating index file*/
+  E_OPEN_FILE=(-5),  /*error while opening index file*/
+  E_CLOSE_FILE=(-6),  /*error while closing index file*/
+  E_WRITE_FILE=(-7),  /*error while writing to index file*/
+  E_READ_FILE=(-8),  /*error while reading from index file*/
+  E_MOVE_FILE=(-9),  /*unable to move within the index file*/
+  E_NO_MEMORY=(-10),  /*there is no available memory*/
+  E_TREE_EMPTY=(-11),  /*cannot search an empty tree*/
+  E_INCOMPATIBLE_VERSION=(-12),  /*incompatible version with data*/
+  E_END_OF_SCAN=(-13),  /*the cursor has passed the last key*/
+  E_TREE_TOO_DEEP=(-14),  /*the tree is deeper than MAX_TREE_HEIGHT*/
+  E_NOT_FOUND=(-15),  /*the value is not in the tree*/
+  E_NO_POSTINGS=(-16),  /*the index file keeps no posting lists*/
+  E_KEY_TYPE=(-17),  /*the index file holds keys of the other type*/
+  E_KEY_TOO_LONG=(-18),  /*the string key is longer than BP_STRING_MAX*/
+  E_BAD_NAME=(-19),  /*the tree name is empty or too long*/
+  E_KEY_SOURCE=(-20),  /*the function reading keys failed*/
+  E_NO_COMPACT=(-21)  /*the tree keeps posting lists or shares its file*/
+} status_t;
+
+typedef struct bp_tree bp_tree_t;  /*an open index file*/
+typedef struct bp_snapshot bp_snapshot_t;  /*a pinned version of a tree*/
+typedef struct bp_cursor bp_cursor_t;  /*a position inside a snapshot*/
+typedef struct bp_catalog bp_catalog_t;  /*an open file of named trees*/
+
+/*the kinds of tree a catalog file can hold,as bp_create...() makes them*/
+typedef enum { BP_PLAIN=0,BP_EPSILON=1,BP_COUNTED=2,BP_POSTINGS=3,
+	       BP_STRINGS=4 } bp_kind_t;
+
+#define BP_STRING_MAX 240  /*the longest key of a string index file*/
+#define BP_SPLIT_LEVELS 16  /*split counters,the last one counts the rest*/
+
+/*the operations the I/O counters are kept for*/
+typedef enum { BP_OP_INSERT=0,BP_OP_SEARCH=1,BP_OP_SCAN=2,BP_OP_OTHER=3,
+	       BP_OPS=4 } bp_op_t;
+
+/*the I/O of one type of operation*/
+typedef struct
+{
+  unsigned long calls;  /*operations started (keys for bp_insert_batch)*/
+  unsigned long pages_read;  /*nodes read from the index file*/
+  unsigned long pages_written;  /*nodes written to the index file*/
+  unsigned long bytes_written;  /*bytes written,headers included*/
+  unsigned long seeks;  /*calls to fseek()*/
+  unsigned long flushes;  /*calls to fflush()*/
+  unsigned long cache_hits;  /*node reads served from memory*/
+  unsigned long cache_misses;  /*node reads that went to the index file*/
+} bp_io_t;
+
+/*I/O counters of an open index file,kept since it was opened*/
+typedef struct
+{
+  bp_io_t total;  /*the sum over every operation*/
+  bp_io_t op[BP_OPS];  /*by operation,indexed by bp_op_t*/
+  unsigned long splits[BP_SPLIT_LEVELS];  /*node splits,leaves at level 0*/
+  unsigned long bloom_skips;  /*lookups the Bloom filter answered unread*/
+  unsigned long log_bytes;  /*value bytes appended to the value log*/
+  unsigned long gc_moved;  /*live value bytes the log collector copied*/
+  unsigned long gc_freed;  /*value log segments the collector removed*/
+} bp_stats_t;
+
+#define BP_HIST_SUB_BITS 4  /*buckets per power of two are 2^BP_HIST_SUB_BITS*/
+#define BP_HIST_BUCKETS 720  /*enough for every latency below 2^48 ns*/
+
+/*the operations latency histograms are kept for;a batch is a call of
+  bp_insert_batch(),bp_build() or bp_load(),whatever its size*/
+typedef enum { BP_LAT_INSERT=0,BP_LAT_SEARCH=1,BP_LAT_SCAN=2,BP_LAT_SPLIT=3,
+	       BP_LAT_FLUSH=4,BP_LAT_BATCH=5,BP_LATS=6 } bp_lat_t;
+
+/*a log-bucketed histogram of latencies in nanoseconds*/
+typedef struct
+{
+  unsigned long count;  /*samples recorded*/
+  unsigned long max_ns;  /*the largest sample*/
+  double sum_ns;  /*the sum of the samples,for the mean*/
+  unsigned long bucket[BP_HIST_BUCKETS];  /*samples per bucket*/
+} bp_histogram_t;
+
+/*latency histograms of an open index file,indexed by bp_lat_t*/
+typedef struct
+{
+  bp_histogram_t hist[BP_LATS];
+} bp_latency_t;
+
+/*called by bp_scan() for every key in the range,nonzero stops the scan*/
+typedef int (*bp_scan_fn)(word_t value,void *arg);
+
+/*called by bp_postings() for every id of a key,nonzero stops the walk*/
+typedef int (*bp_posting_fn)(unsigned long id,void *arg);
+
+/*called by bp_scan_strings() for every key in the range,nonzero stops it*/
+typedef int (*bp_string_fn)(const void *key,size_t length,void *arg);
+
+/*called by bp_get_string() for every piece of a value,nonzero stops it*/
+typedef int (*bp_value_fn)(const void *data,size_t length,void *arg);
+
+/*called by bp_load() for every key:1 with the key,0 at the end or a
+  negative value on an error*/
+typedef int (*bp_key_fn)(word_t *const value,void *arg);
+
+/*index files;a B-epsilon file buffers inserts in its internal nodes,a
+  counted one keeps the number of keys under every child and a postings
+  one only the posting lists,which every file but a plain one keeps*/
+extern status_t bp_create(const char *const name,bp_tree_t **const tree);
+extern status_t bp_open(const char *const name,bp_tree_t **const tree);
+extern status_t bp_create_epsilon(const char *const name,
+				  bp_tree_t **const tree);
+extern status_t bp_create_counted(const char *const name,
+				  bp_tree_t **const tree);
+extern status_t bp_create_postings(const char *const name,
+				   bp_tree_t **const tree);
+extern status_t bp_close(bp_tree_t *const tree);
+
+/*many trees in one file,named in its catalog:they share one open file,its
+  buffer and the space at its end.  bp_catalog_tree() opens a tree,adding
+  it with the kind given if the file has none of that name;its handle is
+  closed with bp_close(),and every handle before the catalog*/
+extern status_t bp_catalog_create(const char *const name,
+				  bp_catalog_t **const catalog);
+extern status_t bp_catalog_open(const char *const name,
+				bp_catalog_t **const catalog);
+extern status_t bp_catalog_tree(bp_catalog_t *const catalog,
+				const char *const name,bp_kind_t kind,
+				bp_tree_t **const tree);
+extern status_t bp_catalog_close(bp_catalog_t *const catalog);
+
+/*updates and lookups*/
+extern status_t bp_insert(bp_tree_t *const tree,word_t value);
+extern status_t bp_insert_batch(bp_tree_t *const tree,
+			       const word_t *const values,size_t count);
+extern status_t bp_build(bp_tree_t *const tree,const word_t *const values,
+		       size_t count,int threads);
+extern status_t bp_load(bp_tree_t *const tree,bp_key_fn fn,void *arg,
+			size_t memory,int threads);
+extern status_t bp_compact(bp_tree_t *const tree,int fill,size_t pages,
+			   int *const done);
+extern status_t bp_search(bp_tree_t *const tree,word_t value);
+extern status_t bp_scan(bp_tree_t *const tree,word_t low,word_t high,
+			bp_scan_fn fn,void *arg);
+
+/*non-unique keys:a list of ids per key,stored apart from the nodes*/
+extern status_t bp_insert_posting(bp_tree_t *const tree,word_t value,
+				  unsigned long id);
+extern status_t bp_postings(bp_tree_t *const tree,word_t value,
+			    bp_posting_fn fn,void *arg);
+
+/*string index files:byte-string keys in slotted pages,in memcmp() order;
+  the calls above are for word keys and return E_KEY_TYPE on these files*/
+extern status_t bp_create_strings(const char *const name,
+				  bp_tree_t **const tree);
+extern status_t bp_insert_string(bp_tree_t *const tree,const void *key,
+				 size_t length);
+extern status_t bp_search_string(bp_tree_t *const tree,const void *key,
+				 size_t length);
+extern status_t bp_scan_strings(bp_tree_t *const tree,const void *low,
+				size_t low_length,const void *high,
+				size_t high_length,bp_string_fn fn,void *arg);
+
+/*values of string keys;a long one lives in overflow pages,read only here*/
+extern status_t bp_put_string(bp_tree_t *const tree,const void *key,
+			      size_t length,const void *value,
+			      size_t value_length);
+extern status_t bp_get_string(bp_tree_t *const tree,const void *key,
+			      size_t length,bp_value_fn fn,void *arg);
+
+/*a value log next to the file,which takes long values in their place,and
+  its collector,which runs in steps from an idle loop*/
+extern status_t bp_value_log(bp_tree_t *const tree);
+extern status_t bp_log_gc(bp_tree_t *const tree,size_t bytes);
+
+/*order statistics,a descent on a counted file and a scan on the others*/
+extern status_t bp_rank(bp_tree_t *const tree,word_t value,
+			unsigned long *const rank);
+extern status_t bp_select(bp_tree_t *const tree,unsigned long rank,
+			  word_t *const value);
+extern status_t bp_count(bp_tree_t *const tree,word_t low,word_t high,
+			 unsigned long *const count);
+
+/*consistent reads that run alongside updates*/
+extern status_t bp_snapshot_open(bp_tree_t *const tree,
+				 bp_snapshot_t **const snap);
+extern status_t bp_snapshot_close(bp_tree_t *const tree,
+				  bp_snapshot_t *const snap);
+extern status_t bp_cursor_open(bp_tree_t *const tree,
+			       bp_snapshot_t *const snap,word_t low,
+			       bp_cursor_t **const cur);
+extern status_t bp_cursor_next(bp_tree_t *const tree,bp_cursor_t *const cur,
+			       word_t *const value);
+extern void bp_cursor_close(bp_cursor_t *const cur);
+
+/*an in-memory write buffer,drained into the file in sorted passes*/
+extern status_t bp_memtable(bp_tree_t *const tree,size_t keys);
+extern status_t bp_flush(bp_tree_t *const tree);
+
+/*a Bloom filter in memory that answers most lookups of absent keys*/
+extern status_t bp_bloom(bp_tree_t *const tree,size_t keys);
+
+extern status_t bp_stats(bp_tree_t *const tree,bp_stats_t *const stats);
+
+/*latency histograms;copies taken from several handles can be merged*/
+extern status_t bp_latency(bp_tree_t *const tree,bp_latency_t *const lat);
+extern status_t bp_latency_reset(bp_tree_t *const tree);
+extern void bp_latency_merge(bp_latency_t *const into,
+			     const bp_latency_t *const from);
+extern unsigned long bp_percentile(const bp_histogram_t *const hist,
+				   double fraction);
+extern void bp_latency_print(FILE *const iop,const bp_latency_t *const lat);
+extern const char *bp_strerror(status_t status);
+
+#endif
@@ -1,6 +1,19 @@
 /****************************************************************************
 	   b_print.c: Prints the B+ tree created by b_plus.c
 			    Georgios Drakopoulos
+
+   Syntax: b_print [-d|-s] <index file name>
+
+   The records of the file are printed in the order they are stored,from
+   the end of the header on:nodes,string pages,posting extents,overflow
+   pages and catalog pages,each told apart by its tag.  The file is read
+   in large sequential pieces and the output is gathered before it is
+   written.  b_print waits for enter after each record;-d dumps the whole
+   file without stopping,for another program to read.  -s reports the
+   shape of each tree instead:its height,the nodes on each level and how
+   full they are,how many leaves are stored right after the leaf before
+   them and the bytes per key,with the records no tree reaches.  It reads
+   the file once,in order,and keeps a few words for each record.
 ****************************************************************************/
 
 #include <string.h>
@@ -9,70 +22,72 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-#define MACHINE_16  /*use MACHINE_xx to specify an architecture of xx bits*/
-
-/*define machine-independent unsigned variable types*/
-#if defined(MACHINE_16)  /*suitable for PC's*/
-  #define WORD_T_TYPE "%u"  /*input-size modifier for ...printf()*/
-  #define WORD_T_MAX 65535  /*the maximum value of a word_t variable*/
-  #define WORD_T_LSB 0x0001  /*the least significant bit of a word_t value*/
-  typedef unsigned char byte_t;  /*8-bit unsigned quantity*/
-  typedef unsigned int word_t;  /*16-bit unsigned quantity*/
-#elif defined(MACHINE_32)  /*suitable for UNIX servers diogenis and zenon*/
-  #define WORD_T_TYPE "%hu"  /*input-size modifier for ...printf()*/
-  #define WORD_T_MAX 65535
-  #define WORD_T_LSB 0x0001
-  typedef unsigned char byte_t;
-  typedef unsigned short word_t;
-#else
-  #error Unsupported architecture or MACHINE_xx not defined.
-#endif
+#include "b_format.h"
 
 #define FILE_BUFFER_SIZE 128  /*buffer size for file name*/
-#define WORD_BUFFER_SIZE 8  /*buffer size for a word_t variable*/
-
-#define NO_BLOCK -1L  /*value indicating end of path in the tree*/
+#define INPUT_SIZE (1L<<20)  /*the bytes of one read of the index file*/
+#define OUTPUT_SIZE 65536  /*the bytes of output gathered before a write*/
+#define MAX_HEIGHT 32  /*the deepest level the statistics keep*/
+#define FILL_BUCKETS 10  /*the fill of the nodes of a level,in tenths*/
 
-#define TREE_ORDER 4  /*the order of the B+ tree*/
-
-/*specify the domain and the range of the boolean type*/
-typedef enum { false=0,true=1 } boolean_t;
-
-/*define the structure of a B+ tree node*/
+/*a record of the file,as the statistics keep it*/
 typedef struct
 {
-  boolean_t is_leaf;  /*is the current node a leaf?*/
-  word_t keys_used;  /*indicates how many keys are used*/
-  word_t key[TREE_ORDER];  /*the keys for the search*/
-  long block[TREE_ORDER+1];  /*the block of the children*/
-  long parent_block;  /*the block of the parent*/
-} node_t;
+  long at;  /*its offset*/
+  size_t bytes;  /*its length*/
+  int tag;  /*its tag:true for a leaf,false for an internal node*/
+  unsigned long used;  /*the keys of a node,the bytes used of a page*/
+  unsigned long keys;  /*the keys it holds,buffered inserts included*/
+  size_t link,links;  /*the blocks it points at,in links[]*/
+  int level;  /*its depth in its tree,-1 until a tree reaches it*/
+} shape_t;
 
 /*options to initialize the B+ tree*/
 typedef struct
 {
   char name[FILE_BUFFER_SIZE];  /*buffer that contains the file name*/
   boolean_t file_exists;  /*true if exists,false if must be created*/
+  boolean_t dump;  /*true to print without stopping*/
+  boolean_t stats;  /*true to report the shape of the trees instead*/
   FILE *iop;  /*the pointer to B+ tree index file returned by tree_open()*/
   node_t *p;  /*pointer to current node in memory*/
+  size_t block_size;  /*the size of the nodes,or pages,of the file*/
+  long at;  /*the offset of the next record*/
+  byte_t *input;  /*the part of the file read in*/
+  size_t next,used;  /*the unread part of input[]*/
+  size_t output_used;  /*the bytes waiting in output[]*/
+  char output[OUTPUT_SIZE];  /*output gathered for one write*/
+  shape_t *shapes;  /*the records of the file,for the statistics*/
+  size_t shapes_used,shapes_size;  /*how many and room*/
+  long *links;  /*the blocks they point at*/
+  size_t links_used,links_size;  /*how many and room*/
+  catalog_entry_t *trees;  /*the trees of the file*/
+  size_t trees_used,trees_size;  /*how many and room*/
 } options_t;
 
-/*header information for the B+ tree file*/
+/*the shape of a tree*/
 typedef struct
 {
-  size_t header_size;  /*the size of the header_t in bytes*/
-  size_t block_size;  /*the size of node_t in bytes*/
-  word_t tree_order;  /*the order of the stored tree*/
-  long root_block;  /*the block of the root*/
-} header_t;
+  const header_t *h;  /*its header*/
+  int height;  /*its levels*/
+  unsigned long nodes[MAX_HEIGHT];  /*the nodes on each level*/
+  unsigned long fill[MAX_HEIGHT][FILL_BUCKETS];  /*and how full they are*/
+  unsigned long permille[MAX_HEIGHT];  /*the sum of their fill*/
+  unsigned long keys,bytes;  /*its keys and the bytes of its records*/
+  unsigned long leaves,sequential;  /*its leaves,and those stored right
+				       after the leaf before them*/
+  const shape_t *last_leaf;  /*the last leaf reached*/
+} tree_shape_t;
 
 /****************************************************************************
 		      main function-argument parsing
-   -INPUT: The index file name.
+   -INPUT: The index file name,after -d to dump it without stopping or -s
+			   for its statistics.
    -OUTPUT: A symbolic value defined in <stdlib.h>
 ****************************************************************************/
 static void open_b_plus_tree(options_t *const opt,header_t *const h);
-static void print_b_plus_tree(options_t *const opt,header_t *const h);
+static void print_b_plus_tree(options_t *const opt);
+static void print_shape(options_t *const opt,header_t *const h);
 static void close_b_plus_tree(options_t *const opt);
 static void allocate_block(options_t *const opt,header_t *const h);
 static void deallocate_block(options_t *const opt);
@@ -81,27 +96,49 @@ static void error(const char *const format,...);
 int main(int argc,char *argv[]);
 int main(int argc,char *argv[])
 {
-  options_t options;  /*struct containing the tree's options*/
+  options_t *options;  /*struct containing the tree's options*/
   header_t header;  /*the header of the index file*/
 
+  if((options=(options_t *)malloc(sizeof(options_t)))==NULL)
+    error("%s","Insufficient memory to run program.\n");
   /*initialize the options struct*/
-  options.file_exists=true;
-  options.iop=NULL;
-  options.p=NULL;
+  options->file_exists=true;
+  options->dump=options->stats=false;
+  options->iop=NULL;
+  options->p=NULL;
+  options->input=NULL;
+  options->next=options->used=options->output_used=0;
+  options->shapes=NULL;
+  options->links=NULL;
+  options->trees=NULL;
+  options->shapes_used=options->shapes_size=0;
+  options->links_used=options->links_size=0;
+  options->trees_used=options->trees_size=0;
 
   if(signal(SIGINT,SIG_IGN)==SIG_ERR)  /*disable Ctrl-C interrupts*/
     error("%s","Cannot install interrupt handler.\n");
-  if(argc!=2)
-    error("%s","Syntax: b_print <index file name>\n");
+  if(argc==3&&(strcmp(argv[1],"-d")==0||strcmp(argv[1],"-s")==0))
+  {
+    if(argv[1][1]=='d')
+      options->dump=true;
+    else options->stats=true;
+    --argc;
+    ++argv;
+  }
+  if(argc!=2||strlen(argv[1])>=FILE_BUFFER_SIZE)
+    error("%s","Syntax: b_print [-d|-s] <index file name>\n");
   else
   {
-    strcpy(options.name,*++argv);
-    open_b_plus_tree(&options,&header);
-    allocate_block(&options,&header);
-    print_b_plus_tree(&options,&header);
-    deallocate_block(&options);
-    close_b_plus_tree(&options);
+    strcpy(options->name,*++argv);
+    open_b_plus_tree(options,&header);
+    allocate_block(options,&header);
+    print_b_plus_tree(options);
+    if(options->stats==true)
+      print_shape(options,&header);
+    deallocate_block(options);
+    close_b_plus_tree(options);
   }
+  free(options);
   return EXIT_SUCCESS;
 }
 
@@ -123,17 +160,17 @@ static void error(const char *const format,...)
 }
 
 /****************************************************************************
-   allocate_block: Reserves a memory block equal to block size stored in
-		    index file header (h->block_size).
+   allocate_block: Reserves a node and the buffer the file is read into.
    -INPUT: A constant pointer to an options_t struct and a constant pointer
-	   to a header_t struct which contains the exact block size.
+	   to a header_t struct.
    -OUTPUT: None.
 ****************************************************************************/
 static void allocate_block(options_t *const opt,header_t *const h)
 {
   if(opt==NULL||h==NULL)
     error("%s","Null input pointer assignment.\n");
-  if((opt->p=(node_t *)malloc(h->block_size))==NULL)
+  if((opt->p=(node_t *)malloc(sizeof(node_t)))==NULL||
+     (opt->input=(byte_t *)malloc((size_t)INPUT_SIZE))==NULL)
     error("%s","Insufficient memory to run program.\n");
   return;
 }
@@ -148,59 +185,718 @@ static void deallocate_block(options_t *const opt)
   if(opt==NULL)
     error("%s","Null input pointer assignment.\n");
   free(opt->p);
+  free(opt->input);
+  free(opt->shapes);
+  free(opt->links);
+  free(opt->trees);
   opt->p=NULL;  /*just a precaution*/
+  opt->input=NULL;
+  opt->shapes=NULL;
+  opt->links=NULL;
+  opt->trees=NULL;
   return;
 }
 /****************************************************************************
     open_b_plus_tree: Opens the index file,assigns the file pointer of the
     the corresponding stream to a member of an options_t struct and places
-		the index file header to a header_t struct.
+   the index file header to a header_t struct.  The nodes of a catalog file
+	  take the block size its trees share,from its catalog pages.
    -INPUT: A constant pointer to an options_t struct and a constant pointer
 	   to a header_t struct.
    -OUTPUT: None.
 ****************************************************************************/
 static void open_b_plus_tree(options_t *const opt,header_t *const h)
 {
+  catalog_t catalog;
+  word_t index;
+  long block;
+
   if(opt==NULL||h==NULL)
     error("%s","Null input pointer assignment.");
   if((opt->iop=fopen(opt->name,"rb"))==NULL)
     error("Cannot open index file %s.\n",opt->name);
+  if(setvbuf(opt->iop,NULL,_IONBF,0)!=0)  /*reads are large already*/
+    error("Cannot read from index file %s.\n",opt->name);
   if(fread((void *)h,sizeof(header_t),1,opt->iop)!=1)
     error("Cannot read from index file %s.\n",opt->name);
+  if(h->header_size!=sizeof(header_t))
+    error("%s is not an index file.\n",opt->name);
+  opt->block_size=h->block_size;
+  if(CATALOG(h))
+    for(opt->block_size=0,block=h->root_block;block!=NO_BLOCK;
+	block=catalog.next)
+    {
+      if(fseek(opt->iop,block,SEEK_SET)!=0||
+	 fread(&catalog,CATALOG_SIZE,1,opt->iop)!=1||
+	 catalog.tag!=CATALOG_TAG||catalog.entries>CATALOG_ENTRIES)
+	error("Cannot read the catalog of index file %s.\n",opt->name);
+      for(index=0;index<catalog.entries;++index)
+	if(opt->block_size==0)
+	  opt->block_size=catalog.entry[index].header.block_size;
+	else if(catalog.entry[index].header.block_size!=opt->block_size)
+	  error("The trees of %s are of different kinds.\n",opt->name);
+    }
+  if(opt->block_size>sizeof(node_t)&&opt->block_size!=STRING_PAGE_SIZE)
+    error("%s is not an index file.\n",opt->name);
+  if(fseek(opt->iop,(long)h->header_size,SEEK_SET)!=0)
+    error("Cannot move to the first block of index file %s.\n",opt->name);
+  opt->at=(long)h->header_size;
   return;
 }
 
 /****************************************************************************
-     print_b_plus_tree: Prints sequentially the nodes of the B+ tree.
+   read_record: Makes the next bytes of the file available,reading on in
+	     INPUT_SIZE pieces when the part read in runs out.
+   -INPUT: A constant pointer to an options_t struct and the bytes.
+   -OUTPUT: The bytes,or NULL if the file ends first.
+****************************************************************************/
+static const byte_t *read_record(options_t *const opt,size_t bytes)
+{
+  size_t count;
+
+  if(opt->used-opt->next<bytes)
+  {
+    memmove(opt->input,opt->input+opt->next,opt->used-opt->next);
+    opt->used-=opt->next;
+    opt->next=0;
+    count=fread(opt->input+opt->used,1,(size_t)INPUT_SIZE-opt->used,
+		opt->iop);
+    if(count==0&&ferror(opt->iop))
+      error("Cannot read from index file %s.\n",opt->name);
+    opt->used+=count;
+    if(opt->used<bytes)
+      return NULL;
+  }
+  return opt->input+opt->next;
+}
+
+/****************************************************************************
+   put_text/put_number/put_signed: Add text or a number to the output,
+	      writing the output out when it has no room left.
+   -INPUT: A constant pointer to an options_t struct and what to add.
+   -OUTPUT: None.
+****************************************************************************/
+static void flush_output(options_t *const opt)
+{
+  if(opt->output_used>0&&
+     fwrite(opt->output,1,opt->output_used,stdout)!=opt->output_used)
+    error("%s","Cannot write to the standard output.\n");
+  opt->output_used=0;
+  return;
+}
+
+static void put_bytes(options_t *const opt,const char *const text,
+		      size_t length)
+{
+  if(opt->output_used+length>OUTPUT_SIZE)
+    flush_output(opt);
+  memcpy(opt->output+opt->output_used,text,length);
+  opt->output_used+=length;
+  return;
+}
+
+static void put_text(options_t *const opt,const char *const text)
+{
+  put_bytes(opt,text,strlen(text));
+  return;
+}
+
+static void put_number(options_t *const opt,unsigned long number)
+{
+  char digits[24];
+  size_t first;
+
+  first=sizeof(digits);
+  do
+    digits[--first]=(char)('0'+number%10UL);
+  while((number/=10UL)>0);
+  put_bytes(opt,digits+first,sizeof(digits)-first);
+  return;
+}
+
+static void put_signed(options_t *const opt,long number)
+{
+  if(number<0)
+  {
+    put_bytes(opt,"-",1);
+    put_number(opt,0UL-(unsigned long)number);
+  }
+  else put_number(opt,(unsigned long)number);
+  return;
+}
+
+/*a string key,with bytes that are not printable as \xhh*/
+static void put_key(options_t *const opt,const byte_t *const key,
+		    size_t length)
+{
+  static const char hex[]="0123456789abcdef";
+  char escape[4];
+  size_t index;
+
+  for(index=0;index<length;++index)
+    if(key[index]>=' '&&key[index]<0x7F&&key[index]!='\\')
+      put_bytes(opt,(const char *)key+index,1);
+    else
+    {
+      escape[0]='\\';
+      escape[1]='x';
+      escape[2]=hex[key[index]>>4];
+      escape[3]=hex[key[index]&0x0F];
+      put_bytes(opt,escape,4);
+    }
+  return;
+}
+
+/****************************************************************************
+   print_node: Prints a node of a tree of words,with its subtree counts,
+	       posting lists and buffered inserts if it has them.
+   -INPUT: A constant pointer to an options_t struct,with the node in p.
+   -OUTPUT: None.
+****************************************************************************/
+static void print_node(options_t *const opt)
+{
+  const node_t *const p=opt->p;
+  word_t index;
+
+  put_text(opt,">Keys in node:");
+  put_number(opt,(unsigned long)p->keys_used);
+  put_text(opt,(p->is_leaf==true)?"\n>Leaf.\n":"\n>Node.\n");
+  if(p->parent_block==NO_BLOCK)
+    put_text(opt,">Current node is the root of the B+ tree.\n");
+  else
+  {
+    put_text(opt,"Parent block:");
+    put_signed(opt,p->parent_block);
+    put_text(opt,".\n");
+  }
+  for(index=0;index<p->keys_used&&index<TREE_ORDER;++index)
+  {
+    put_number(opt,(unsigned long)p->key[index]);
+    put_bytes(opt," ",1);
+  }
+  put_bytes(opt,"\n",1);
+  for(index=0;index<=p->keys_used&&index<=TREE_ORDER;++index)
+    if(p->block[index]==NO_BLOCK)
+      put_text(opt,"<nip>");
+    else
+    {
+      put_signed(opt,p->block[index]);
+      put_bytes(opt," ",1);
+    }
+  put_bytes(opt,"\n",1);
+  if(COUNTED(opt)&&p->is_leaf==false)  /*keys under each child*/
+  {
+    for(index=0;index<=p->keys_used&&index<=TREE_ORDER;++index)
+    {
+      put_number(opt,p->count[index]);
+      put_bytes(opt," ",1);
+    }
+    put_bytes(opt,"\n",1);
+  }
+  if(POSTINGS(opt))  /*the first extent of each posting list*/
+  {
+    put_text(opt,"Postings:");
+    for(index=0;index<p->keys_used&&index<TREE_ORDER;++index)
+    {
+      put_bytes(opt," ",1);
+      put_signed(opt,p->ref[index]);
+    }
+    put_bytes(opt,"\n",1);
+  }
+  if(BUFFERED(opt)&&p->msgs_used>0)
+  {
+    put_text(opt,"Buffered:");
+    for(index=0;index<p->msgs_used&&index<BUFFER_SIZE;++index)
+    {
+      put_bytes(opt," ",1);
+      put_number(opt,(unsigned long)p->msg[index]);
+    }
+    put_bytes(opt,"\n",1);
+  }
+  return;
+}
+
+/****************************************************************************
+   print_page: Prints a page of a string tree,a key on each line:with the
+   child right of it in an internal page,with where its value is in a leaf.
+   -INPUT: A constant pointer to an options_t struct and the page.
+   -OUTPUT: None.
+****************************************************************************/
+static void print_page(options_t *const opt,const byte_t *const page)
+{
+  const page_t *const head=(const page_t *)page;
+  const slot_t *const slot=(const slot_t *)(page+sizeof(page_t));
+  word_t index;
+
+  put_text(opt,">Keys in page:");
+  put_number(opt,(unsigned long)head->slots);
+  put_text(opt,(head->is_leaf==true)?"\n>Leaf.\nNext leaf:":
+	   "\n>Node.\nFirst child:");
+  put_signed(opt,head->first);
+  put_bytes(opt,"\n",1);
+  if(head->slots>STRING_SLOTS||head->prefix>STRING_PAGE_SIZE)
+  {
+    put_text(opt,"<broken page>\n");
+    return;
+  }
+  for(index=0;index<head->slots;++index)
+  {
+    put_key(opt,page+STRING_PAGE_SIZE-head->prefix,head->prefix);
+    if((size_t)slot[index].offset+slot[index].length<=STRING_PAGE_SIZE)
+      put_key(opt,page+slot[index].offset,slot[index].length);
+    if(head->is_leaf==false)
+      put_text(opt," child:");
+    else if(slot[index].logged!=0)
+      put_text(opt," logged at:");
+    else if(slot[index].child!=NO_BLOCK)
+      put_text(opt," overflow:");
+    else
+    {
+      put_text(opt," value bytes:");
+      put_number(opt,(unsigned long)slot[index].value);
+      put_bytes(opt,"\n",1);
+      continue;
+    }
+    put_signed(opt,slot[index].child);
+    put_bytes(opt,"\n",1);
+  }
+  return;
+}
+
+/****************************************************************************
+   print_other: Prints a posting extent,an overflow page or a catalog page.
+   -INPUT: A constant pointer to an options_t struct,the tag and the record.
+   -OUTPUT: None.
+****************************************************************************/
+static void print_other(options_t *const opt,int tag,
+			const byte_t *const record)
+{
+  const catalog_t *catalog;
+  const overflow_t *over;
+  const posting_t *ext;
+  word_t index;
+
+  switch(tag)
+  {
+    case POSTING_TAG:
+      ext=(const posting_t *)record;
+      put_text(opt,">Posting extent.\nNext:");
+      put_signed(opt,ext->next);
+      put_text(opt," tail:");
+      put_signed(opt,ext->tail);
+      put_text(opt," bytes:");
+      put_number(opt,ext->used);
+      put_bytes(opt,"/",1);
+      put_number(opt,ext->size);
+      put_text(opt," ids:");
+      put_number(opt,ext->ids);
+      put_text(opt," last:");
+      put_number(opt,ext->last);
+      break;
+    case OVERFLOW_TAG:
+      over=(const overflow_t *)record;
+      put_text(opt,">Overflow page.\nNext:");
+      put_signed(opt,over->next);
+      put_text(opt," bytes:");
+      put_number(opt,over->used);
+      put_bytes(opt,"/",1);
+      put_number(opt,over->length);
+      break;
+    default:
+      catalog=(const catalog_t *)record;
+      put_text(opt,">Catalog page.\nNext:");
+      put_signed(opt,catalog->next);
+      for(index=0;index<catalog->entries&&index<CATALOG_ENTRIES;++index)
+      {
+	put_bytes(opt,"\n",1);
+	put_key(opt,(const byte_t *)catalog->entry[index].name,
+		strlen(catalog->entry[index].name));
+	put_text(opt," root:");
+	put_signed(opt,catalog->entry[index].header.root_block);
+	put_text(opt," block size:");
+	put_number(opt,(unsigned long)catalog->entry[index].header.block_size);
+      }
+      break;
+  }
+  put_bytes(opt,"\n",1);
+  return;
+}
+
+/****************************************************************************
+   grow: Doubles the room of an array of the statistics.
+   -INPUT: The array,a pointer to its room in items and the bytes of one.
+   -OUTPUT: The array moved to its new room.
+****************************************************************************/
+static void *grow(void *array,size_t *const size,size_t item)
+{
+  *size=(*size>0)?2**size:1024;
+  if((array=realloc(array,*size*item))==NULL)
+    error("%s","Insufficient memory to run program.\n");
+  return array;
+}
+
+/****************************************************************************
+   note_record: Keeps what the statistics need of a record:its place,the
+   keys it holds,how full it is and the blocks it points at,which are the
+   children of a node,its posting lists and the overflow pages of its
+	     values,or the next record of a chain.
+   -INPUT: A constant pointer to an options_t struct,the tag,the record and
+			    its bytes.
+   -OUTPUT: None.
+****************************************************************************/
+static void add_link(options_t *const opt,long block)
+{
+  if(block==NO_BLOCK)
+    return;
+  if(opt->links_used==opt->links_size)
+    opt->links=(long *)grow(opt->links,&opt->links_size,sizeof(long));
+  opt->links[opt->links_used++]=block;
+  return;
+}
+
+static void note_record(options_t *const opt,int tag,
+			const byte_t *const record,size_t bytes)
+{
+  const catalog_t *catalog;
+  const page_t *head;
+  const slot_t *slot;
+  shape_t *shape;
+  word_t index;
+
+  if(opt->shapes_used==opt->shapes_size)
+    opt->shapes=(shape_t *)grow(opt->shapes,&opt->shapes_size,
+				sizeof(shape_t));
+  shape=&opt->shapes[opt->shapes_used++];
+  shape->at=opt->at;
+  shape->bytes=bytes;
+  shape->tag=tag;
+  shape->used=shape->keys=0UL;
+  shape->link=opt->links_used;
+  shape->level=-1;
+  switch(tag)
+  {
+    case POSTING_TAG:
+      add_link(opt,((const posting_t *)record)->next);
+      break;
+    case OVERFLOW_TAG:
+      add_link(opt,((const overflow_t *)record)->next);
+      break;
+    case CATALOG_TAG:
+      catalog=(const catalog_t *)record;
+      add_link(opt,catalog->next);
+      for(index=0;index<catalog->entries&&index<CATALOG_ENTRIES;++index)
+      {
+	if(opt->trees_used==opt->trees_size)
+	  opt->trees=(catalog_entry_t *)grow(opt->trees,&opt->trees_size,
+					     sizeof(catalog_entry_t));
+	opt->trees[opt->trees_used++]=catalog->entry[index];
+      }
+      break;
+    default:
+      if(opt->block_size==STRING_PAGE_SIZE)
+      {
+	head=(const page_t *)record;
+	slot=(const slot_t *)(record+sizeof(page_t));
+	if(head->slots>STRING_SLOTS||head->heap>STRING_PAGE_SIZE)
+	  break;
+	shape->keys=head->slots;
+	shape->used=sizeof(page_t)+head->slots*sizeof(slot_t)+
+		    (STRING_PAGE_SIZE-head->heap);
+	if(head->is_leaf==false)
+	  add_link(opt,head->first);
+	for(index=0;index<head->slots;++index)
+	  if(head->is_leaf==false||slot[index].logged==0)
+	    add_link(opt,slot[index].child);
+      }
+      else
+      {
+	memset(opt->p,0,sizeof(node_t));
+	memcpy(opt->p,record,bytes);
+	if(opt->p->keys_used>=TREE_ORDER||opt->p->msgs_used>BUFFER_SIZE)
+	  break;
+	shape->used=opt->p->keys_used;
+	shape->keys=opt->p->keys_used+opt->p->msgs_used;
+	if(opt->p->is_leaf==false)
+	  for(index=0;index<=opt->p->keys_used;++index)
+	    add_link(opt,opt->p->block[index]);
+	if(POSTINGS(opt))
+	  for(index=0;index<opt->p->keys_used;++index)
+	    add_link(opt,opt->p->ref[index]);
+      }
+      break;
+  }
+  shape->links=opt->links_used-shape->link;
+  return;
+}
+
+/****************************************************************************
+   reach: Walks a tree from a block over the records noted,in key order,
+   giving each node its level and adding it to the shape of the tree.  A
+   record already reached is not walked again,and a chain of extents or
+			    pages is followed.
+   -INPUT: A constant pointer to an options_t struct,the shape of the tree,
+			    the block and its level.
+   -OUTPUT: None.
+****************************************************************************/
+static shape_t *find_shape(options_t *const opt,long block)
+{
+  size_t low,high,middle;
+
+  for(low=0,high=opt->shapes_used;low<high;)
+  {
+    middle=low+(high-low)/2;
+    if(opt->shapes[middle].at==block)
+      return &opt->shapes[middle];
+    if(opt->shapes[middle].at<block)
+      low=middle+1;
+    else high=middle;
+  }
+  return NULL;
+}
+
+static void reach(options_t *const opt,tree_shape_t *const tree,long block,
+		  int level)
+{
+  unsigned long permille,most;
+  shape_t *shape;
+  size_t index;
+
+  while((shape=find_shape(opt,block))!=NULL&&shape->level<0)
+  {
+    shape->level=level;
+    tree->bytes+=(unsigned long)shape->bytes;
+    if(shape->tag>true)  /*an extent,an overflow or a catalog page*/
+    {
+      block=(shape->links>0)?opt->links[shape->link]:NO_BLOCK;
+      continue;
+    }
+    if(level>=MAX_HEIGHT)
+      return;
+    if(STRINGS(tree->h))
+      most=STRING_PAGE_SIZE;
+    else most=(tree->h->tree_order>1)?tree->h->tree_order-1UL:1UL;
+    permille=(shape->used>=most)?1000UL:(1000UL*shape->used+most/2)/most;
+    ++tree->nodes[level];
+    ++tree->fill[level][permille*FILL_BUCKETS/1001UL];
+    tree->permille[level]+=permille;
+    if(shape->tag==true||!STRINGS(tree->h))  /*separators are copies*/
+      tree->keys+=shape->keys;
+    if(level>=tree->height)
+      tree->height=level+1;
+    if(shape->tag==true)
+    {
+      ++tree->leaves;
+      if(tree->last_leaf!=NULL&&
+	 tree->last_leaf->at+(long)tree->last_leaf->bytes==shape->at)
+	++tree->sequential;
+      tree->last_leaf=shape;
+    }
+    for(index=0;index<shape->links;++index)
+      reach(opt,tree,opt->links[shape->link+index],level+1);
+    return;
+  }
+  return;
+}
+
+/****************************************************************************
+   put_decimal: Adds a quotient to the output,with one decimal.
+   -INPUT: A constant pointer to an options_t struct,the dividend and the
+		   divisor;a divisor of 0 prints a dash.
+   -OUTPUT: None.
+****************************************************************************/
+static void put_decimal(options_t *const opt,unsigned long dividend,
+			unsigned long divisor)
+{
+  unsigned long tenths;
+  char digit;
+
+  if(divisor==0)
+  {
+    put_bytes(opt,"-",1);
+    return;
+  }
+  tenths=(10UL*dividend+divisor/2)/divisor;
+  put_number(opt,tenths/10UL);
+  digit=(char)('0'+tenths%10UL);
+  put_bytes(opt,".",1);
+  put_bytes(opt,&digit,1);
+  return;
+}
+
+/****************************************************************************
+   print_shape: Walks every tree of the file over the records noted by the
+   scan and reports its shape,then the records no tree reaches:those left
+	     behind by updates,which a compaction gives back.
    -INPUT: A constant pointer to an options_t struct and a constant pointer
 	   to a header_t struct.
    -OUTPUT: None.
 ****************************************************************************/
-static void print_b_plus_tree(options_t *const opt,header_t *const h)
+static void print_shape(options_t *const opt,header_t *const h)
 {
-  word_t index;
+  unsigned long dead,dead_bytes,used;
+  tree_shape_t *tree;
+  size_t index;
+  int level,tenth;
+
+  if((tree=(tree_shape_t *)malloc(sizeof(tree_shape_t)))==NULL)
+    error("%s","Insufficient memory to run program.\n");
+  if(CATALOG(h))
+  {
+    memset(tree,0,sizeof(tree_shape_t));
+    tree->h=h;
+    reach(opt,tree,h->root_block,0);  /*the catalog pages*/
+  }
+  else
+  {
+    if((opt->trees=(catalog_entry_t *)malloc(sizeof(catalog_entry_t)))==NULL)
+      error("%s","Insufficient memory to run program.\n");
+    opt->trees->name[0]='\0';
+    opt->trees->header=*h;
+    opt->trees_used=1;
+  }
+  for(index=0;index<opt->trees_used;++index)
+  {
+    memset(tree,0,sizeof(tree_shape_t));
+    tree->h=&opt->trees[index].header;
+    if(tree->h->root_block!=NO_BLOCK)
+      reach(opt,tree,tree->h->root_block,0);
+    put_text(opt,">Tree");
+    if(opt->trees[index].name[0]!='\0')
+    {
+      put_bytes(opt," ",1);
+      put_key(opt,(const byte_t *)opt->trees[index].name,
+	      strlen(opt->trees[index].name));
+    }
+    put_text(opt,".\nHeight:");
+    put_number(opt,(unsigned long)tree->height);
+    put_text(opt," keys:");
+    put_number(opt,tree->keys);
+    put_text(opt," bytes:");
+    put_number(opt,tree->bytes);
+    put_text(opt," bytes per key:");
+    put_decimal(opt,tree->bytes,tree->keys);
+    put_bytes(opt,"\n",1);
+    for(level=0;level<tree->height;++level)
+    {
+      put_text(opt,"Level ");
+      put_number(opt,(unsigned long)level);
+      put_text(opt,":");
+      put_number(opt,tree->nodes[level]);
+      put_text(opt," nodes,fill ");
+      put_decimal(opt,tree->permille[level],10UL*tree->nodes[level]);
+      put_text(opt,"%,by tenths:");
+      for(tenth=0;tenth<FILL_BUCKETS;++tenth)
+      {
+	put_bytes(opt," ",1);
+	put_number(opt,tree->fill[level][tenth]);
+      }
+      put_bytes(opt,"\n",1);
+    }
+    put_text(opt,"Leaves:");
+    put_number(opt,tree->leaves);
+    put_text(opt," stored after the leaf before them:");
+    put_decimal(opt,100UL*tree->sequential,
+		(tree->leaves>1)?tree->leaves-1:0UL);
+    put_text(opt,"%\n\n");
+  }
+  for(index=0,dead=dead_bytes=0UL;index<opt->shapes_used;++index)
+    if(opt->shapes[index].level<0)
+    {
+      ++dead;
+      dead_bytes+=(unsigned long)opt->shapes[index].bytes;
+    }
+  used=(unsigned long)opt->at;
+  put_text(opt,">File.\nBytes:");
+  put_number(opt,used);
+  put_text(opt," records:");
+  put_number(opt,(unsigned long)opt->shapes_used);
+  put_text(opt," dead records:");
+  put_number(opt,dead);
+  put_text(opt," dead bytes:");
+  put_number(opt,dead_bytes);
+  put_text(opt," (");
+  put_decimal(opt,100UL*dead_bytes,used);
+  put_text(opt,"%)\n");
+  flush_output(opt);
+  free(tree);
+  return;
+}
+
+/****************************************************************************
+   print_b_plus_tree: Prints sequentially the records of the index file,
+   from the end of its header on,waiting for enter after each one unless
+	  dumping;for the statistics,it notes them instead.
+   -INPUT: A constant pointer to an options_t struct.
+   -OUTPUT: None.
+****************************************************************************/
+static void print_b_plus_tree(options_t *const opt)
+{
+  const byte_t *record;
+  size_t bytes;
+  int tag;
 
-  if(fseek(opt->iop,h->block_size,SEEK_SET)!=0)
-    error("Cannot move to root block of index file %s.\n",opt->name);
-  while(fread(opt->p,h->block_size,1,opt->iop)==1)
-  {
-    fprintf(stdout,">Keys in node:" WORD_T_TYPE "\n",opt->p->keys_used);
-    fprintf(stdout,"%s",(opt->p->is_leaf==true)?">Leaf.\n":">Node.\n");
-    if(opt->p->parent_block==NO_BLOCK)
-      fprintf(stdout,"%s",">Current node is the root of the B+ tree.\n");
-    else fprintf(stdout,"Parent block:%ld.\n",opt->p->parent_block);
-    for(index=0;index<opt->p->keys_used;++index)
-      fprintf(stdout,WORD_T_TYPE " ",opt->p->key[index]);
-    fputc('\n',stdout);
-    for(index=0;index<=opt->p->keys_used;++index)
-      if(opt->p->block[index]==NO_BLOCK)
-	fprintf(stdout,"%s","<nip>");
-      else fprintf(stdout,"%ld ",opt->p->block[index]);
-    fputc('\n',stdout);
-    fprintf(stdout,"%s","\nPress enter to continue...");
-    fgetc(stdin);
-    fflush(stdout);
+  bytes=0;
+  while((record=read_record(opt,sizeof(int)))!=NULL)
+  {
+    memcpy(&tag,record,sizeof(int));
+    switch(tag)
+    {
+      case false:
+      case true:
+	bytes=opt->block_size;
+	break;
+      case POSTING_TAG:
+	if((record=read_record(opt,sizeof(posting_t)))==NULL)
+	  bytes=sizeof(posting_t);
+	else bytes=sizeof(posting_t)+((const posting_t *)record)->size;
+	break;
+      case OVERFLOW_TAG:
+	bytes=STRING_PAGE_SIZE;
+	break;
+      case CATALOG_TAG:
+	bytes=CATALOG_SIZE;
+	break;
+      default:
+	error("Unknown record at offset %ld of index file %s.\n",opt->at,
+	      opt->name);
+    }
+    if(bytes==0||bytes>(size_t)INPUT_SIZE||
+       (record=read_record(opt,bytes))==NULL)
+      error("Index file %s ends inside the record at offset %ld.\n",
+	    opt->name,opt->at);
+    if(opt->stats==true)
+    {
+      note_record(opt,tag,record,bytes);
+      opt->next+=bytes;
+      opt->at+=(long)bytes;
+      continue;
+    }
+    put_text(opt,">Block ");
+    put_signed(opt,opt->at);
+    put_text(opt,".\n");
+    if(tag>true)
+      print_other(opt,tag,record);
+    else if(opt->block_size==STRING_PAGE_SIZE)
+      print_page(opt,record);
+    else
+    {
+      memset(opt->p,0,sizeof(node_t));
+      memcpy(opt->p,record,bytes);
+      print_node(opt);
+    }
+    opt->next+=bytes;
+    opt->at+=(long)bytes;
+    if(opt->dump==true)
+      put_bytes(opt,"\n",1);
+    else
+    {
+      put_text(opt,"\nPress enter to continue...");
+      flush_output(opt);
+      fflush(stdout);
+      fgetc(stdin);
+    }
   }
+  flush_output(opt);
   return;
 }
 
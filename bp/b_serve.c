@@ -0,0 +1,536 @@
+/****************************************************************************
+	 b_serve.c: Serves a B+ tree index file over a Unix domain socket.
+			  Georgios Drakopoulos
+
+   Syntax: b_serve <index file> <socket path>
+
+   The server owns the index file,so any number of local processes can
+   share it without opening it themselves.  Requests and responses are
+   binary,all words 16-bit little endian:
+	get	01 key			-> frame
+	put	02 key			-> frame
+	batch	03 count key ...	-> frame
+	scan	04 low high		-> frame ... frame
+   A frame is one status byte (the negated status_t value),a count and
+   that many keys.  get answers SUCCESS or E_NOT_FOUND,put and batch
+   answer SUCCESS,and only scan frames carry keys:a scan sends frames of
+   up to SCAN_CHUNK keys and ends with an E_END_OF_SCAN frame of none.
+   Clients may pipeline requests;the answers come back in order.
+   SIGUSR1 dumps the latency histograms of the index file to stderr;puts
+   reach the engine grouped,so they are counted under batch,not insert.
+   SIGUSR2 starts a compaction,which rewrites the index file in key order
+   COMPACT_PAGES pages at a time between requests;puts go on meanwhile,
+   and it waits for running scans to finish before it reuses the front
+   of the file.  A signal handler writes a byte to a pipe that the event
+   loop polls along with the sockets,so a signal that comes just before
+		  poll() still wakes an idle server.
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L  /*sigaction(),sockets under a strict -std*/
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "b_plus.h"
+
+#define SERVER_BUFFER_SIZE 65536  /*input and output buffer of a client*/
+#define MAX_CLIENTS 64  /*the most connections served at a time*/
+#define MAX_BATCH 4096  /*the most keys in one batch request*/
+#define SCAN_CHUNK 512  /*the most keys in one scan frame*/
+#define FRAME_SIZE(keys) (3+2*(keys))  /*bytes in a frame of keys*/
+#define COMPACT_FILL 100  /*the percentage of a node a compaction fills*/
+#define COMPACT_PAGES 64  /*the pages a compaction step reads or writes*/
+#define COMPACT_PAUSE 1  /*milliseconds between the steps of an idle server*/
+
+/*the request codes of the protocol*/
+enum op { OP_GET=1,OP_PUT=2,OP_BATCH=3,OP_SCAN=4 };
+
+/*the state of one connection*/
+typedef struct
+{
+  int fd;  /*the connected socket*/
+  int eof;  /*nonzero once the client has stopped sending*/
+  int dead;  /*nonzero once the connection has failed*/
+  size_t in_used;  /*bytes of requests waiting in in[]*/
+  size_t out_next,out_used;  /*the unsent part of out[]*/
+  bp_snapshot_t *snap;  /*the snapshot of a running scan,or NULL*/
+  bp_cursor_t *cur;  /*the cursor of the running scan*/
+  word_t high;  /*the upper bound of the running scan*/
+  byte_t in[SERVER_BUFFER_SIZE];  /*requests read from the socket*/
+  byte_t out[SERVER_BUFFER_SIZE];  /*frames not yet sent*/
+} client_t;
+
+static volatile sig_atomic_t stop=0;  /*set by SIGINT and SIGTERM*/
+static volatile sig_atomic_t dump=0;  /*set by SIGUSR1*/
+static volatile sig_atomic_t compact=0;  /*set by SIGUSR2*/
+static int wake[2]={-1,-1};  /*a pipe the signal handler writes to*/
+static word_t pending[SERVER_BUFFER_SIZE/2];  /*keys of the pending puts*/
+
+/****************************************************************************
+		      main function-argument parsing
+   -INPUT: The index file name and the path of the socket.
+   -OUTPUT: A symbolic value defined in <stdlib.h>
+****************************************************************************/
+static int open_socket(const char *const path);
+static int serve_client(bp_tree_t *const tree,client_t *const c);
+static void drop_client(bp_tree_t *const tree,client_t *const c);
+static void on_signal(int sig);
+static void error(const char *const format,...);
+
+int main(int argc,char *argv[]);
+int main(int argc,char *argv[])
+{
+  struct pollfd fds[MAX_CLIENTS+2];  /*the listening socket,the clients and
+				       the wake-up pipe*/
+  client_t *client[MAX_CLIENTS];  /*the connected clients*/
+  int listener,clients,index,busy,fd,compacting,done;
+  static bp_latency_t lat;  /*dumped on SIGUSR1*/
+  char drained[16];  /*bytes taken from the wake-up pipe*/
+  struct sigaction action;
+  bp_tree_t *tree;
+  status_t status;
+  ssize_t count;
+  client_t *c;
+
+  if(argc!=3)
+    error("%s","Syntax: b_serve <index file> <socket path>\n");
+  if((status=bp_open(argv[1],&tree))==E_OPEN_FILE)
+    status=bp_create(argv[1],&tree);
+  if(status!=SUCCESS)
+    error("%s: %s\n",argv[1],bp_strerror(status));
+  if(pipe(wake)<0||fcntl(wake[0],F_SETFL,O_NONBLOCK)<0||
+     fcntl(wake[1],F_SETFL,O_NONBLOCK)<0)
+    error("Cannot create the wake-up pipe: %s.\n",strerror(errno));
+  memset(&action,0,sizeof(action));
+  action.sa_handler=on_signal;  /*stays installed,unlike signal() in SysV*/
+  sigemptyset(&action.sa_mask);
+  if(signal(SIGPIPE,SIG_IGN)==SIG_ERR||sigaction(SIGINT,&action,NULL)<0||
+     sigaction(SIGTERM,&action,NULL)<0||sigaction(SIGUSR1,&action,NULL)<0||
+     sigaction(SIGUSR2,&action,NULL)<0)
+    error("%s","Cannot install interrupt handler.\n");
+  listener=open_socket(argv[2]);
+
+  clients=0;
+  busy=compacting=0;
+  while(stop==0)
+  {
+    if(dump!=0)
+    {
+      dump=0;
+      if(bp_latency(tree,&lat)==SUCCESS)
+	bp_latency_print(stderr,&lat);
+    }
+    if(compact!=0)
+    {
+      compact=0;
+      compacting=1;
+    }
+    if(compacting!=0)  /*one step between two rounds of requests*/
+    {
+      if((status=bp_compact(tree,COMPACT_FILL,COMPACT_PAGES,&done))!=SUCCESS)
+	fprintf(stderr,"%s: %s\n",argv[1],bp_strerror(status));
+      if(status!=SUCCESS||done!=0)
+	compacting=0;
+    }
+    fds[0].fd=listener;
+    fds[0].events=(clients<MAX_CLIENTS)?POLLIN:0;
+    for(index=0;index<clients;++index)
+    {
+      c=client[index];
+      fds[index+1].fd=c->fd;
+      fds[index+1].events=0;
+      if(c->eof==0&&c->in_used<SERVER_BUFFER_SIZE)
+	fds[index+1].events|=POLLIN;
+      if(c->out_next<c->out_used)
+	fds[index+1].events|=POLLOUT;
+    }
+    fds[clients+1].fd=wake[0];
+    fds[clients+1].events=POLLIN;
+    if(poll(fds,(nfds_t)(clients+2),
+	    (busy!=0)?0:(compacting!=0)?COMPACT_PAUSE:-1)<0)
+    {
+      if(errno==EINTR)
+	continue;
+      error("Cannot poll the clients: %s.\n",strerror(errno));
+    }
+    if((fds[clients+1].revents&POLLIN)!=0)  /*the flags are read next round*/
+      while(read(wake[0],drained,sizeof(drained))>0)
+	;
+
+    for(index=0;index<clients;++index)
+    {
+      c=client[index];
+      if((fds[index+1].revents&(POLLIN|POLLHUP|POLLERR))!=0&&c->eof==0&&
+	 c->in_used<SERVER_BUFFER_SIZE)  /*a full buffer is served first*/
+      {
+	count=read(c->fd,c->in+c->in_used,SERVER_BUFFER_SIZE-c->in_used);
+	if(count>0)
+	  c->in_used+=(size_t)count;
+	else if(count==0||(errno!=EAGAIN&&errno!=EINTR))
+	  c->eof=1;
+      }
+      if((fds[index+1].revents&POLLOUT)!=0)
+      {
+	count=write(c->fd,c->out+c->out_next,c->out_used-c->out_next);
+	if(count>0)
+	  c->out_next+=(size_t)count;
+	else if(count<0&&errno!=EAGAIN&&errno!=EINTR)
+	  c->dead=1;  /*the client is gone*/
+      }
+    }
+
+    /*serve every client in turn,so a long scan cannot starve the rest*/
+    busy=0;
+    for(index=0;index<clients;)
+    {
+      c=client[index];
+      busy|=serve_client(tree,c);
+      if(c->dead!=0||
+	 (c->eof!=0&&c->snap==NULL&&c->out_next==c->out_used))
+      {
+	drop_client(tree,c);
+	client[index]=client[--clients];
+      }
+      else ++index;
+    }
+
+    if((fds[0].revents&POLLIN)!=0&&clients<MAX_CLIENTS&&
+       (fd=accept(listener,NULL,NULL))>=0)
+    {
+      if(fcntl(fd,F_SETFL,O_NONBLOCK)<0||
+	 (c=(client_t *)malloc(sizeof(client_t)))==NULL)
+	close(fd);
+      else
+      {
+	c->fd=fd;
+	c->eof=c->dead=0;
+	c->in_used=c->out_next=c->out_used=0;
+	c->snap=NULL;
+	c->cur=NULL;
+	client[clients++]=c;
+      }
+    }
+  }
+
+  for(index=0;index<clients;++index)
+    drop_client(tree,client[index]);
+  close(listener);
+  close(wake[0]);
+  close(wake[1]);
+  unlink(argv[2]);
+  if((status=bp_close(tree))!=SUCCESS)
+    error("%s: %s\n",argv[1],bp_strerror(status));
+  return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+	error: Prints a message in stderr and quits the program.
+   -INPUT: The error message.
+   -OUTPUT: A symbolic value defined in <stdlib.h>
+****************************************************************************/
+static void error(const char *const format,...)
+{
+  va_list arg_ptr;  /*pointer to argument list*/
+
+  va_start(arg_ptr,format);
+  if(format==NULL)
+    fprintf(stderr,"%s","An unknown error has occured.\n");
+  else vfprintf(stderr,format,arg_ptr);
+  exit(EXIT_FAILURE);
+  va_end(arg_ptr);
+}
+
+/****************************************************************************
+   on_signal: Asks the event loop to shut the server down,to dump the
+		latency histograms or to start a compaction.
+   -INPUT: The signal number.
+   -OUTPUT: None.
+****************************************************************************/
+static void on_signal(int sig)
+{
+  const int saved=errno;
+  ssize_t sent;
+
+  if(sig==SIGUSR1)
+    dump=1;
+  else if(sig==SIGUSR2)
+    compact=1;
+  else stop=1;
+  sent=write(wake[1],"",1);  /*a full pipe wakes the loop all the same*/
+  (void)sent;
+  errno=saved;
+  return;
+}
+
+/****************************************************************************
+   open_socket: Creates the listening socket,replacing a stale one left
+			  at the same path.
+   -INPUT: The path of the socket.
+   -OUTPUT: The listening descriptor.
+****************************************************************************/
+static int open_socket(const char *const path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if(strlen(path)>=sizeof(addr.sun_path))
+    error("Socket path %s is too long.\n",path);
+  memset(&addr,0,sizeof(addr));
+  addr.sun_family=AF_UNIX;
+  strcpy(addr.sun_path,path);
+  if((fd=socket(AF_UNIX,SOCK_STREAM,0))<0)
+    error("Cannot create socket: %s.\n",strerror(errno));
+  unlink(path);
+  if(bind(fd,(struct sockaddr *)&addr,sizeof(addr))<0||listen(fd,16)<0)
+    error("Cannot listen on %s: %s.\n",path,strerror(errno));
+  if(fcntl(fd,F_SETFL,O_NONBLOCK)<0)
+    error("Cannot listen on %s: %s.\n",path,strerror(errno));
+  return fd;
+}
+
+/****************************************************************************
+   get_word/put_frame: Reads a word of a request and appends a frame to
+     the output of a client.  The caller checks there is room for it.
+   -INPUT: The bytes of the word,or the client,the status and the keys.
+   -OUTPUT: The word,or none.
+****************************************************************************/
+static word_t get_word(const byte_t *const p)
+{
+  return (word_t)(p[0]|(p[1]<<8));
+}
+
+static void put_frame(client_t *const c,status_t status,
+		      const word_t *const keys,word_t count)
+{
+  byte_t *p;
+  word_t index;
+
+  if(c->out_next==c->out_used)  /*everything was sent,start over*/
+    c->out_next=c->out_used=0;
+  else if(c->out_used+FRAME_SIZE(count)>SERVER_BUFFER_SIZE)
+  {
+    memmove(c->out,c->out+c->out_next,c->out_used-c->out_next);
+    c->out_used-=c->out_next;
+    c->out_next=0;
+  }
+  p=c->out+c->out_used;
+  *p++=(byte_t)-status;
+  *p++=(byte_t)(count&0xFFU);
+  *p++=(byte_t)((count>>8)&0xFFU);
+  for(index=0;index<count;++index)
+  {
+    *p++=(byte_t)(keys[index]&0xFFU);
+    *p++=(byte_t)((keys[index]>>8)&0xFFU);
+  }
+  c->out_used+=FRAME_SIZE(count);
+  return;
+}
+
+/****************************************************************************
+   room: Tells whether the output of a client can take more bytes.
+   -INPUT: The client and the number of bytes.
+   -OUTPUT: Nonzero if they fit.
+****************************************************************************/
+static int room(const client_t *const c,size_t bytes)
+{
+  return c->out_used-c->out_next+bytes<=SERVER_BUFFER_SIZE;
+}
+
+/****************************************************************************
+   request_size: Measures the request at the front of the input of a
+			       client.
+   -INPUT: The first byte of the request and the bytes available.
+   -OUTPUT: The size of the request,0 if it is incomplete or -1 if it is
+	    malformed.
+****************************************************************************/
+static long request_size(const byte_t *const p,size_t available)
+{
+  long size;
+
+  switch(*p)
+  {
+    case OP_GET:
+    case OP_PUT:
+      size=3L;
+      break;
+    case OP_BATCH:
+      if(available<3)
+	return 0L;
+      if(get_word(p+1)>MAX_BATCH)
+	return -1L;
+      size=3L+2L*(long)get_word(p+1);
+      break;
+    case OP_SCAN:
+      size=5L;
+      break;
+    default:
+      return -1L;
+  }
+  return ((size_t)size>available)?0L:size;
+}
+
+/****************************************************************************
+   end_scan: Releases the cursor and the snapshot of a running scan.
+   -INPUT: The tree and the client.
+   -OUTPUT: None.
+****************************************************************************/
+static void end_scan(bp_tree_t *const tree,client_t *const c)
+{
+  if(c->cur!=NULL)
+    bp_cursor_close(c->cur);
+  if(c->snap!=NULL)
+    bp_snapshot_close(tree,c->snap);
+  c->cur=NULL;
+  c->snap=NULL;
+  return;
+}
+
+/****************************************************************************
+   drop_client: Closes a connection and frees its state.
+   -INPUT: The tree and the client.
+   -OUTPUT: None.
+****************************************************************************/
+static void drop_client(bp_tree_t *const tree,client_t *const c)
+{
+  end_scan(tree,c);
+  close(c->fd);
+  free(c);
+  return;
+}
+
+/****************************************************************************
+   continue_scan: Sends the next frame of a running scan.  The scan reads
+     from its own snapshot,so puts from other clients go on in between.
+   -INPUT: The tree and the client.
+   -OUTPUT: None.
+****************************************************************************/
+static void continue_scan(bp_tree_t *const tree,client_t *const c)
+{
+  word_t keys[SCAN_CHUNK],count,value;
+  status_t status;
+
+  count=0;
+  while(count<SCAN_CHUNK&&
+	(status=bp_cursor_next(tree,c->cur,&value))==SUCCESS)
+  {
+    if(value>c->high)
+    {
+      status=E_END_OF_SCAN;
+      break;
+    }
+    keys[count++]=value;
+  }
+  if(count>0)
+    put_frame(c,SUCCESS,keys,count);
+  if(status!=SUCCESS)  /*the range is over or the scan failed*/
+  {
+    put_frame(c,status,NULL,0);
+    end_scan(tree,c);
+  }
+  return;
+}
+
+/****************************************************************************
+   apply_puts: Inserts the keys of the pending put and batch requests in
+      one engine batch and answers each of those requests.
+   -INPUT: The tree,the client,the number of keys and of requests.
+   -OUTPUT: None.
+****************************************************************************/
+static void apply_puts(bp_tree_t *const tree,client_t *const c,
+		       size_t keys,size_t requests)
+{
+  status_t status;
+
+  if(requests==0)
+    return;
+  status=bp_insert_batch(tree,pending,keys);
+  while(requests-->0)
+    put_frame(c,status,NULL,0);
+  return;
+}
+
+/****************************************************************************
+   serve_client: Answers the complete requests of a client,in order,as far
+     as its output buffer allows.  Consecutive puts and batches go to the
+		       engine as one batch.
+   -INPUT: The tree and the client.
+   -OUTPUT: Nonzero if the client has more work that needs no I/O.
+****************************************************************************/
+static int serve_client(bp_tree_t *const tree,client_t *const c)
+{
+  size_t next,keys,requests;
+  word_t count,index;
+  status_t status;
+  long size;
+  byte_t *p;
+
+  if(c->snap!=NULL)  /*a scan holds back the requests behind it*/
+  {
+    if(!room(c,FRAME_SIZE(SCAN_CHUNK)+FRAME_SIZE(0)))
+      return 0;
+    continue_scan(tree,c);
+    return c->snap!=NULL||c->in_used>0;
+  }
+  next=keys=requests=0;
+  while(next<c->in_used&&(size=request_size(c->in+next,c->in_used-next))!=0)
+  {
+    p=c->in+next;
+    if(size<0)  /*a malformed request ends the connection*/
+    {
+      c->dead=1;
+      break;
+    }
+    if(*p==OP_PUT||*p==OP_BATCH)
+    {
+      if(!room(c,FRAME_SIZE(0)*(requests+1)))
+	break;
+      if(*p==OP_PUT)
+	pending[keys++]=get_word(p+1);
+      else for(index=0,count=get_word(p+1);index<count;++index)
+	pending[keys++]=get_word(p+3+2*index);
+      ++requests;
+    }
+    else
+    {
+      /*the pending puts are answered first,then the request itself*/
+      if(!room(c,FRAME_SIZE(0)*(requests+1)+FRAME_SIZE(SCAN_CHUNK)))
+	break;
+      apply_puts(tree,c,keys,requests);
+      keys=requests=0;
+      if(*p==OP_GET)
+      {
+	status=bp_search(tree,get_word(p+1));
+	put_frame(c,(status==E_TREE_EMPTY)?E_NOT_FOUND:status,NULL,0);
+      }
+      else
+      {
+	c->high=get_word(p+3);
+	if((status=bp_snapshot_open(tree,&c->snap))!=SUCCESS||
+	   (status=bp_cursor_open(tree,c->snap,get_word(p+1),&c->cur))!=
+	   SUCCESS)
+	{
+	  put_frame(c,status,NULL,0);
+	  end_scan(tree,c);
+	}
+	else continue_scan(tree,c);
+      }
+    }
+    next+=(size_t)size;
+    if(c->snap!=NULL)
+      break;
+  }
+  apply_puts(tree,c,keys,requests);
+  memmove(c->in,c->in+next,c->in_used-next);
+  c->in_used-=next;
+  return c->snap!=NULL;
+}
@@ -0,0 +1,5163 @@
+/****************************************************************************
+	    b_tree.c: The B+ tree engine behind the libbplus library.
+			  Georgios Drakopoulos
+****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L  /*ftruncate(),fileno() under a strict -std*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(BP_THREADS)
+  #include <pthread.h>
+#endif
+#if defined(__unix__)||defined(__APPLE__)
+  #include <unistd.h>
+  #define TRUNCATE_FILE(iop,size) ftruncate(fileno(iop),(off_t)(size))
+#else
+  #define TRUNCATE_FILE(iop,size) 0  /*the freed tail stays in the file*/
+#endif
+
+#include "b_plus.h"
+#include "b_format.h"
+
+#define FILE_BUFFER_SIZE 128  /*buffer size for file name*/
+
+#define MAX_TREE_HEIGHT 32  /*the deepest path a cursor can follow*/
+#define CARRY_SIZE (BUFFER_SIZE*MAX_TREE_HEIGHT)  /*see cursor_t.carry*/
+#define VERSION_HASH_SIZE 64  /*number of buckets in the page version store*/
+#define SEQUENTIAL_RUN 3  /*inserts in one direction that make a run*/
+#define SPLIT_SHARE 10  /*a run leaves 1/SPLIT_SHARE of a node to its tail*/
+#define BLOOM_BITS_PER_KEY 10  /*about 1% false positives at the planned size*/
+#define BLOOM_PROBES 7  /*bits set and tested per key*/
+#define BUILD_UNITS 4  /*subtrees per thread of a parallel build*/
+#define BUILD_THREADS 64  /*the most threads a build uses*/
+#define SORT_MIN_KEYS 1024  /*the smallest run of a sorted load*/
+#define SORT_FAN_IN 16  /*the runs a merge pass reads at once*/
+
+/*static tracepoints of provider bplus,for perf and bpftrace;building with
+  -DBP_TRACE needs <sys/sdt.h>,and without it they compile to nothing*/
+#if defined(BP_TRACE)
+  #include <sys/sdt.h>
+  #define TRACE1(name,a) DTRACE_PROBE1(bplus,name,a)
+  #define TRACE2(name,a,b) DTRACE_PROBE2(bplus,name,a,b)
+  #define TRACE3(name,a,b,c) DTRACE_PROBE3(bplus,name,a,b,c)
+#else
+  #define TRACE1(name,a) ((void)0)
+  #define TRACE2(name,a,b) ((void)0)
+  #define TRACE3(name,a,b,c) ((void)0)
+#endif
+
+/*is a value a key?  word_t may be wider than WORD_T_MAX,all ones*/
+#define KEY_IN_RANGE(value) \
+  (((unsigned long)(value)&~(unsigned long)WORD_T_MAX)==0)
+
+/*charges I/O to the running operation and to the totals*/
+#define COUNT_IO(opt,field,n) \
+  ((opt)->stats.op[(opt)->op].field+=(n),(opt)->stats.total.field+=(n))
+
+/*a before-image of a node,kept while some snapshot may still need it*/
+typedef struct version
+{
+  long block;  /*the block the image was taken from*/
+  unsigned long begin;  /*the first update epoch the image is valid for*/
+  unsigned long end;  /*the update epoch that overwrote the image*/
+  node_t node;  /*the contents of the block before the overwrite*/
+  struct version *next;  /*next image in the same hash bucket*/
+} version_t;
+
+/*a consistent read-only view of the B+ tree*/
+typedef struct bp_snapshot
+{
+  unsigned long epoch;  /*the last update visible to the snapshot*/
+  long root_block;  /*the block of the root when the snapshot was taken*/
+  long end_block;  /*the end of the index file at that time*/
+  struct bp_snapshot *next;  /*the next older live snapshot*/
+} snapshot_t;
+
+/*a key of a string page,decoded*/
+typedef struct
+{
+  size_t length;  /*the bytes of the key*/
+  size_t value_length;  /*the bytes of the value in the leaf*/
+  boolean_t logged;  /*is the value in the value log?*/
+  long child;  /*the child right of the key,or where the value lies*/
+  byte_t key[BP_STRING_MAX];  /*the whole key,prefix included*/
+  byte_t value[VALUE_INLINE];  /*the value,if it is in the leaf*/
+} entry_t;
+
+/*options to initialize the B+ tree*/
+typedef struct
+{
+  char name[FILE_BUFFER_SIZE];  /*buffer that contains the file name*/
+  boolean_t file_exists;  /*true if exists,false if must be created*/
+  FILE *iop;  /*the pointer to B+ tree index file returned by tree_open()*/
+  node_t *p;  /*pointer to current node in memory*/
+  unsigned long epoch;  /*the number of updates completed so far*/
+  snapshot_t *snapshots;  /*the live snapshots,newest first*/
+  version_t *version[VERSION_HASH_SIZE];  /*before-images by block*/
+  bp_stats_t stats;  /*the I/O counters*/
+  bp_op_t op;  /*the operation the I/O is charged to*/
+  word_t key;  /*the key of the running operation,for the tracepoints*/
+  word_t last_value;  /*the value inserted last*/
+  int run;  /*inserts in a row above (>0) or below (<0) the previous one*/
+  long tail_block;  /*the rightmost leaf,NO_BLOCK until an insert finds it*/
+  node_t tail;  /*a copy of the rightmost leaf,kept by put_block()*/
+  long top_block;  /*the root of a B-epsilon tree once read,or NO_BLOCK*/
+  node_t top;  /*a copy of that root,kept by put_block()*/
+  boolean_t top_dirty;  /*does top hold inserts its block lacks?*/
+  word_t *memtable;  /*inserts not yet in the file,ascending,or NULL*/
+  size_t mem_used,mem_size;  /*the keys in the memtable and its capacity*/
+  unsigned char *bloom;  /*a Bloom filter of every key inserted,or NULL*/
+  unsigned long bloom_mask;  /*the number of bits in bloom[] less one*/
+  int depth;  /*the internal nodes a counted insert passed,see push_path()*/
+  long path_block[MAX_TREE_HEIGHT];  /*their blocks,from the root down*/
+  word_t path_pos[MAX_TREE_HEIGHT];  /*the child taken in each*/
+  node_t path[MAX_TREE_HEIGHT];  /*and their contents*/
+  byte_t *page;  /*a page of a string tree,NULL in other trees*/
+  entry_t *entry;  /*the keys of that page decoded,with room for one more*/
+  boolean_t log_on;  /*do long values go to the value log?*/
+  FILE *log;  /*the segment the value log appends to,or NULL*/
+  FILE *log_old;  /*an older segment open for reading,or NULL*/
+  unsigned long log_head,log_tail;  /*the first and the last segment*/
+  unsigned long log_old_segment;  /*the segment of log_old*/
+  long log_end;  /*the offset of the next record*/
+  long gc_offset;  /*the record the collector looks at next*/
+  bp_catalog_t *catalog;  /*the file of named trees it is in,or NULL*/
+  long header_at;  /*where its header is kept,in that file's catalog*/
+  struct bp_compact *compact;  /*a compaction under way,or NULL*/
+  bp_latency_t latency;  /*the latency histograms*/
+} options_t;
+
+/*the position of a range scan inside a snapshot*/
+typedef struct bp_cursor
+{
+  snapshot_t *snap;  /*the snapshot the cursor reads from*/
+  int depth;  /*the level of the current key in node[],-1 at the end*/
+  node_t node[MAX_TREE_HEIGHT];  /*the nodes on the path to the current key*/
+  word_t pos[MAX_TREE_HEIGHT];  /*the next key to visit in each node*/
+  word_t msg_pos[MAX_TREE_HEIGHT];  /*the next buffered insert in each node*/
+  long floor;  /*every key below it has been returned or skipped*/
+  int carry_next,carry_used;  /*the unreturned part of carry[]*/
+  word_t carry[CARRY_SIZE];  /*buffered inserts of nodes already left*/
+  options_t *opt;  /*the index file it was opened on,for its latency*/
+  unsigned long elapsed_ns;  /*the time spent in the scan so far*/
+} cursor_t;
+
+/*a subtree of a bulk build,laid out in consecutive blocks:its root,then
+  the subtree of each child in turn*/
+typedef struct
+{
+  const word_t *values;  /*its keys,ascending*/
+  size_t count;  /*the number of keys*/
+  int height;  /*its levels,1 for a leaf*/
+  long block;  /*the block of its root*/
+  long parent;  /*the block of the parent of its root,or NO_BLOCK*/
+} build_t;
+
+/*the stages of a compaction,see bp_compact()*/
+typedef enum { COMPACT_READ=0,COMPACT_COPY=1,COMPACT_WAIT=2,
+	       COMPACT_MOVE=3 } compact_stage_t;
+
+/*a compaction under way*/
+typedef struct bp_compact
+{
+  compact_stage_t stage;  /*what the next step does*/
+  status_t failed;  /*an update it cannot take in,SUCCESS if none*/
+  int per;  /*the keys a node of the new layout holds*/
+  long resume;  /*the key the next read starts at*/
+  byte_t seen[(WORD_T_MAX+1L)/8];  /*a bit for every key read or added*/
+  word_t *late;  /*the keys added once reading was through*/
+  size_t lates,room;  /*how many and how many fit*/
+  word_t *values;  /*the keys in ascending order,once all are read*/
+  size_t count;  /*how many*/
+  long copy;  /*the block the copy at the end of the file starts at*/
+  long size;  /*the bytes of the new layout*/
+  build_t root;  /*the new layout being written*/
+  build_t *units;  /*its subtrees left for later steps*/
+  size_t used,next;  /*how many and the next one*/
+} compact_t;
+
+/*the file a part of a bulk build is written to*/
+typedef struct
+{
+  FILE *iop;  /*the index file,through a stream of its own*/
+  long at;  /*the offset the stream is at,so it need not seek*/
+  unsigned long nodes;  /*the nodes written*/
+} builder_t;
+
+/*where node_overflow() splits a node*/
+typedef enum { SPLIT_EVEN=0,SPLIT_RIGHT=1,SPLIT_LEFT=2 } split_t;
+
+/*the handle behind bp_tree_t*/
+struct bp_tree
+{
+  options_t opt;  /*the open index file*/
+  header_t header;  /*its header*/
+};
+
+/*the handle behind bp_catalog_t*/
+struct bp_catalog
+{
+  char name[FILE_BUFFER_SIZE];  /*the file name*/
+  FILE *iop;  /*the file,shared by the trees in it*/
+  header_t header;  /*its header,which points at the first catalog page*/
+  int trees;  /*the tree handles open on it*/
+};
+
+static const char *error_msg[]=
+{
+  "No error occured.",
+  "Null pointer to option struct.",
+  "Null pointer to file header struct.",
+  "Null pointer to tree data.",
+  "Cannot create designated index file.",
+  "Cannot open designated index file.",
+  "Cannot close designated index file.",
+  "Cannot write to designated index file.",
+  "Cannot read from designated index file.",
+  "Cannot move within designated index file.",
+  "Insufficient memory to run program.",
+  "The B+ tree is empty.",
+  "The tree order of the index file is incompatible with the program.",
+  "There are no more keys in the scanned range.",
+  "The B+ tree is too deep to be scanned.",
+  "The value does not exist in the B+ tree.",
+  "The index file keeps no posting lists.",
+  "The index file holds keys of another type.",
+  "The string key is too long.",
+  "The tree name is empty or too long.",
+  "Cannot read the keys to load.",
+  "The index file cannot be compacted in place."
+};
+
+static status_t insert_value(header_t *h,options_t *opt,word_t value);
+static status_t merge_values(options_t *const opt,header_t *const h,
+			     const word_t *const values,size_t count);
+static status_t drain_memtable(options_t *const opt,header_t *const h);
+static status_t write_top(options_t *const opt,header_t *const h);
+static status_t locate_key(options_t *const opt,header_t *const h,
+			   word_t value,long *const block,word_t *const pos);
+static status_t place_value(options_t *const opt,header_t *const h,
+			    word_t value);
+static status_t write_block(options_t *const opt,header_t *const h,
+			    long block,const node_t *const node);
+static status_t append_posting(options_t *const opt,long *const head,
+			       unsigned long id);
+static status_t walk_postings(options_t *const opt,long head,
+			      bp_posting_fn fn,void *arg);
+static status_t write_overflow(options_t *const opt,
+			       const byte_t *const value,size_t length,
+			       long *const block);
+static status_t read_overflow(options_t *const opt,long block,
+			      bp_value_fn fn,void *arg);
+static status_t store_string(bp_tree_t *const tree,const void *key,
+			     size_t length,const void *value,
+			     size_t value_length,boolean_t replace);
+static status_t open_log(options_t *const opt);
+static status_t append_log(options_t *const opt,const byte_t *const key,
+			   size_t length,const byte_t *const value,
+			   size_t value_length,long *const offset);
+static status_t read_log(options_t *const opt,long offset,bp_value_fn fn,
+			 void *arg);
+static status_t roll_log(options_t *const opt);
+static status_t copy_log(options_t *const opt,FILE *const iop,
+			 const byte_t *const key,
+			 const log_record_t *const record,long *const offset);
+static status_t gc_log(options_t *const opt,header_t *const h,size_t bytes);
+static status_t insert_string(options_t *const opt,header_t *const h,
+			      const entry_t *const item,boolean_t replace);
+static status_t search_string(options_t *const opt,header_t *const h,
+			      const byte_t *const key,size_t length,
+			      bp_value_fn fn,void *arg);
+static status_t scan_strings(options_t *const opt,header_t *const h,
+			     const byte_t *const low,size_t low_length,
+			     const byte_t *const high,size_t high_length,
+			     bp_string_fn fn,void *arg);
+static status_t build_tree(options_t *const opt,header_t *const h,
+			   const word_t *const values,size_t count,int per,
+			   int threads);
+static status_t spill_run(const word_t *const values,size_t count,
+			  FILE **const iop);
+static status_t compact_tree(options_t *const opt,header_t *const h,
+			     int fill,unsigned long pages,int *const done);
+static void note_compact(options_t *const opt,const word_t *const values,
+			 size_t count);
+static void end_compact(options_t *const opt);
+static status_t merge_runs(FILE **const runs,int count,FILE *const out,
+			   word_t *const values,size_t *const used);
+static void sift_run(int *const heap,int size,const word_t *const head,
+		     int at);
+#if defined(BP_THREADS)
+static status_t build_parallel(options_t *const opt,header_t *const h,
+			       builder_t *const b,const build_t *const root,
+			       int per,int levels,unsigned long fan,
+			       int threads);
+#endif
+static void bloom_add(options_t *const opt,word_t value);
+static boolean_t bloom_test(const options_t *const opt,word_t value);
+static status_t search_value(options_t *const opt,header_t *const h,
+			     word_t value);
+static status_t open_tree(options_t *const opt,header_t *const h);
+static status_t close_tree(options_t *const opt);
+static status_t scan_tree(options_t *const opt,header_t *const h,
+			  word_t low,word_t high,bp_scan_fn fn,void *arg);
+static status_t rank_value(options_t *const opt,header_t *const h,
+			   word_t value,boolean_t inclusive,
+			   unsigned long *const rank);
+static status_t select_value(options_t *const opt,header_t *const h,
+			     unsigned long rank,word_t *const value);
+static status_t count_values(options_t *const opt,header_t *const h,
+			     word_t low,word_t high,unsigned long *const count);
+static status_t open_snapshot(options_t *const opt,header_t *const h,
+			      snapshot_t **const snap);
+static status_t close_snapshot(options_t *const opt,snapshot_t *const snap);
+static status_t open_cursor(options_t *const opt,header_t *const h,
+			    snapshot_t *const snap,word_t low,
+			    cursor_t *const cur);
+static status_t next_cursor(options_t *const opt,header_t *const h,
+			    cursor_t *const cur,word_t *const value);
+static status_t reallocate_block(options_t *const opt);
+static status_t deallocate_block(options_t *const opt);
+static status_t write_header(options_t *const opt,header_t *const h);
+static int seek_file(options_t *const opt,long offset,int whence);
+static status_t flush_file(options_t *const opt);
+static unsigned long now_ns(void);
+static void record_latency(options_t *const opt,bp_lat_t which,
+			   unsigned long start_ns);
+
+/****************************************************************************
+	 bp_create/bp_open: Creates a new index file or opens an
+		  existing one and returns a handle to it.
+   -input: The index file name and a pointer to receive the tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t attach_tree(options_t *const opt,header_t *const h,
+			    bp_catalog_t *const cat,const char *const name);
+
+static status_t new_tree(const char *const name,boolean_t file_exists,
+			 size_t block_size,bp_catalog_t *const cat,
+			 bp_tree_t **const tree)
+{
+  bp_tree_t *t;
+  status_t status;
+  word_t index;
+
+  if(name==NULL||tree==NULL)
+    return INV_DATA_PTR;
+  *tree=NULL;
+  if(cat!=NULL&&(name[0]=='\0'||strlen(name)>=CATALOG_NAME||
+		 strlen(cat->name)+strlen(name)+1>=FILE_BUFFER_SIZE))
+    return E_BAD_NAME;
+  if((t=(bp_tree_t *)malloc(sizeof(bp_tree_t)))==NULL)
+    return E_NO_MEMORY;
+
+  /*load initial values to both header and options;a tree of a catalog
+    file is named after both,for the files of its value log*/
+  if(cat!=NULL)
+  {
+    strcpy(t->opt.name,cat->name);
+    strcat(strcat(t->opt.name,"."),name);
+  }
+  else
+    strncpy(t->opt.name,name,FILE_BUFFER_SIZE-1);
+  t->opt.name[FILE_BUFFER_SIZE-1]='\0';
+  t->opt.file_exists=file_exists;
+  t->opt.p=NULL;
+  t->opt.iop=NULL;
+  t->opt.epoch=0UL;
+  t->opt.snapshots=NULL;
+  t->opt.compact=NULL;
+  for(index=0;index<VERSION_HASH_SIZE;++index)
+    t->opt.version[index]=NULL;
+  memset(&t->opt.stats,0,sizeof(bp_stats_t));
+  memset(&t->opt.latency,0,sizeof(bp_latency_t));
+  t->opt.op=BP_OP_OTHER;
+  t->opt.key=t->opt.last_value=0;
+  t->opt.run=0;
+  t->opt.tail_block=t->opt.top_block=NO_BLOCK;
+  t->opt.top_dirty=false;
+  t->opt.memtable=NULL;
+  t->opt.mem_used=t->opt.mem_size=0;
+  t->opt.bloom=NULL;
+  t->opt.bloom_mask=0UL;
+  t->opt.depth=0;
+  t->opt.page=NULL;
+  t->opt.entry=NULL;
+  t->opt.log_on=false;
+  t->opt.log=t->opt.log_old=NULL;
+  t->opt.log_head=t->opt.log_tail=t->opt.log_old_segment=0UL;
+  t->opt.log_end=t->opt.gc_offset=0L;
+  t->opt.catalog=NULL;
+  t->opt.header_at=0L;
+  t->header.tree_order=TREE_ORDER;
+  t->header.block_size=block_size;  /*bp_open() reads the real one*/
+  t->header.header_size=sizeof(header_t);
+  t->header.root_block=NO_BLOCK;
+
+  if((status=reallocate_block(&t->opt))!=SUCCESS||
+     (status=((cat==NULL)?open_tree(&t->opt,&t->header):
+	      attach_tree(&t->opt,&t->header,cat,name)))!=SUCCESS||
+     (STRINGS(&t->header)&&
+      ((t->opt.page=(byte_t *)malloc(STRING_PAGE_SIZE))==NULL||
+       (t->opt.entry=(entry_t *)malloc((STRING_SLOTS+1)*
+				       sizeof(entry_t)))==NULL)))
+  {
+    if(status==SUCCESS)
+      status=E_NO_MEMORY;
+    free(t->opt.page);
+    free(t->opt.entry);
+    close_tree(&t->opt);
+    deallocate_block(&t->opt);
+    free(t);
+    return status;
+  }
+  *tree=t;
+  return SUCCESS;
+}
+
+status_t bp_create(const char *const name,bp_tree_t **const tree)
+{
+  return new_tree(name,false,PLAIN_BLOCK_SIZE,NULL,tree);
+}
+
+status_t bp_open(const char *const name,bp_tree_t **const tree)
+{
+  return new_tree(name,true,PLAIN_BLOCK_SIZE,NULL,tree);
+}
+
+/****************************************************************************
+   bp_create_epsilon: Creates a new index file in B-epsilon mode:inserts
+   are buffered in the internal nodes and pushed down in batches.  bp_open()
+	      recognises such a file by the size of its blocks.
+   -input: The index file name and a pointer to receive the tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_create_epsilon(const char *const name,bp_tree_t **const tree)
+{
+  return new_tree(name,false,sizeof(node_t),NULL,tree);
+}
+
+/****************************************************************************
+   bp_create_counted: Creates a new index file whose internal nodes keep
+   the number of keys under each child,for bp_rank(),bp_select() and
+   bp_count().  Every insert then rewrites the internal nodes on its path.
+	  bp_open() recognises such a file by the size of its blocks.
+   -input: The index file name and a pointer to receive the tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_create_counted(const char *const name,bp_tree_t **const tree)
+{
+  return new_tree(name,false,COUNTED_BLOCK_SIZE,NULL,tree);
+}
+
+/****************************************************************************
+   bp_create_postings: Creates a new index file whose keys carry posting
+   lists,for bp_insert_posting() and bp_postings(),and nothing else.
+	  bp_open() recognises such a file by the size of its blocks.
+   -input: The index file name and a pointer to receive the tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_create_postings(const char *const name,bp_tree_t **const tree)
+{
+  return new_tree(name,false,POSTING_BLOCK_SIZE,NULL,tree);
+}
+
+/****************************************************************************
+    bp_close: Closes an index file and frees its handle,together with any
+	       snapshot still open on it.  The memtable is drained and a
+		B-epsilon root buffer written back first.
+		      -input: The tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_close(bp_tree_t *const tree)
+{
+  status_t status,drained;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  tree->opt.op=BP_OP_OTHER;
+  if((drained=drain_memtable(&tree->opt,&tree->header))==SUCCESS)
+    drained=write_top(&tree->opt,&tree->header);
+  free(tree->opt.memtable);
+  free(tree->opt.bloom);
+  free(tree->opt.page);
+  free(tree->opt.entry);
+  status=close_tree(&tree->opt);
+  if(drained!=SUCCESS)
+    status=drained;
+  if(tree->opt.log_old!=NULL)
+    fclose(tree->opt.log_old);
+  if(tree->opt.log!=NULL&&fclose(tree->opt.log)==EOF)
+    status=E_CLOSE_FILE;
+  deallocate_block(&tree->opt);
+  free(tree);
+  return status;
+}
+
+/****************************************************************************
+	 bp_insert: Inserts a value into an open index file,or into its
+	 memtable,which is drained into the file once it is full.
+		 -input: The tree handle and the value.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static boolean_t find_word(const word_t *const words,size_t count,
+			   word_t value,size_t *const pos);
+
+status_t bp_insert(bp_tree_t *const tree,word_t value)
+{
+  unsigned long start;
+  status_t status;
+  options_t *opt;
+  size_t pos;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(!KEY_IN_RANGE(value))
+    return INV_DATA_PTR;
+  start=now_ns();
+  opt=&tree->opt;
+  opt->op=BP_OP_INSERT;
+  COUNT_IO(opt,calls,1UL);
+  bloom_add(opt,value);  /*a key that then fails is only a false positive*/
+  if(opt->mem_size>0)
+  {
+    status=SUCCESS;
+    if(find_word(opt->memtable,opt->mem_used,value,&pos)==false)
+    {
+      memmove(opt->memtable+pos+1,opt->memtable+pos,
+	      (opt->mem_used-pos)*sizeof(word_t));
+      opt->memtable[pos]=value;
+      if(++opt->mem_used==opt->mem_size)
+	status=drain_memtable(opt,&tree->header);
+    }
+  }
+  else if((status=insert_value(&tree->header,opt,value))==SUCCESS)
+	 status=flush_file(opt);
+  record_latency(&tree->opt,BP_LAT_INSERT,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_insert_batch: Inserts many values into an open index file with a
+    single flush at the end.  The values are sorted and merged into the
+   tree in one pass,so each leaf they go to is written once where it does
+	     not split.  The whole batch is one batch sample.
+	  -input: The tree handle,the values and their number.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static int compare_words(const void *a,const void *b)
+{
+  word_t x=*(const word_t *)a,y=*(const word_t *)b;
+
+  return (x<y)?-1:(x>y)?1:0;
+}
+
+/****************************************************************************
+   find_word: Binary search of a value in an ascending array of words.
+   -input: The array,its length,the value and a pointer to receive where
+				the value is or would go.
+		 -output: true if the value is there.
+****************************************************************************/
+static boolean_t find_word(const word_t *const words,size_t count,
+			   word_t value,size_t *const pos)
+{
+  size_t low,high,middle;
+
+  low=0;
+  high=count;
+  while(low<high)
+  {
+    middle=low+(high-low)/2;
+    if(words[middle]<value)
+      low=middle+1;
+    else high=middle;
+  }
+  *pos=low;
+  return (low<count&&words[low]==value)?true:false;
+}
+
+status_t bp_insert_batch(bp_tree_t *const tree,const word_t *const values,
+			 size_t count)
+{
+  unsigned long start;
+  size_t index,used;
+  status_t status;
+  word_t *sorted;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(values==NULL&&count>0)
+    return INV_DATA_PTR;
+  for(index=0;index<count;++index)
+    if(!KEY_IN_RANGE(values[index]))
+      return INV_DATA_PTR;
+  if(count==0)
+    return SUCCESS;
+  start=now_ns();
+  tree->opt.op=BP_OP_INSERT;
+  COUNT_IO(&tree->opt,calls,(unsigned long)count);
+  if((sorted=(word_t *)malloc(count*sizeof(word_t)))==NULL)
+    return E_NO_MEMORY;
+  memcpy(sorted,values,count*sizeof(word_t));
+  qsort(sorted,count,sizeof(word_t),compare_words);
+  for(index=used=1;index<count;++index)  /*drop the duplicates*/
+    if(sorted[index]!=sorted[used-1])
+      sorted[used++]=sorted[index];
+  for(index=0;index<used;++index)
+    bloom_add(&tree->opt,sorted[index]);
+  status=merge_values(&tree->opt,&tree->header,sorted,used);
+  free(sorted);
+  if(status==SUCCESS)
+    status=flush_file(&tree->opt);
+  record_latency(&tree->opt,BP_LAT_BATCH,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_build: Loads sorted keys into an empty index file bottom-up,with full
+   nodes,by writing each node once in the order it lies in the file:a
+   subtree takes consecutive blocks,its root first.  The layout follows
+   from the number of keys alone,so threads can build the subtrees below
+   the top levels into the blocks set aside for them at the same time,and
+   the file is the same for any number of threads.  A tree that is not
+     empty takes the keys as bp_insert_batch() does,in one sorted pass.
+   -input: The tree handle,the keys in strictly ascending order,how many
+		   and the threads to build with.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_build(bp_tree_t *const tree,const word_t *const values,
+		  size_t count,int threads)
+{
+  unsigned long start;
+  status_t status;
+  size_t index;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(values==NULL&&count>0)
+    return INV_DATA_PTR;
+  for(index=0;index<count;++index)
+    if(!KEY_IN_RANGE(values[index])||
+       (index>0&&values[index-1]>=values[index]))
+      return INV_DATA_PTR;
+  if(tree->header.root_block!=NO_BLOCK||tree->opt.mem_used>0)
+    return bp_insert_batch(tree,values,count);
+  if(count==0)
+    return SUCCESS;
+  start=now_ns();
+  tree->opt.op=BP_OP_INSERT;
+  COUNT_IO(&tree->opt,calls,(unsigned long)count);
+  for(index=0;index<count;++index)
+    bloom_add(&tree->opt,values[index]);
+  status=build_tree(&tree->opt,&tree->header,values,count,
+		    tree->header.tree_order-1,threads);
+  record_latency(&tree->opt,BP_LAT_BATCH,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_load: Loads keys in any order and in any number into an index file
+   in a few sequential passes.  It sorts runs of as many keys as memory
+   bytes hold and spills each run to a temporary file,merges the runs
+   SORT_FAN_IN at a time until one merge is left and hands the keys of
+   that one to bp_build().  A key above WORD_T_MAX is refused as it is
+   read and duplicates are dropped,so the last merge never yields more
+   than WORD_T_MAX+1 keys.  Input that fits in memory is never spilled.
+   -input: The tree handle,the function that reads the keys,its argument,
+	 the bytes to sort keys in and the threads to build with.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_load(bp_tree_t *const tree,bp_key_fn fn,void *arg,
+		 size_t memory,int threads)
+{
+  size_t keys,used,count,index,runs,slots;
+  word_t *buffer,*sorted;
+  FILE **run,**more,*out;
+  status_t status;
+  int read,group;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(fn==NULL)
+    return INV_DATA_PTR;
+  if((keys=memory/sizeof(word_t))<SORT_MIN_KEYS)
+    keys=SORT_MIN_KEYS;
+  if((buffer=(word_t *)malloc(keys*sizeof(word_t)))==NULL)
+    return E_NO_MEMORY;
+  run=NULL;
+  runs=used=0;
+  status=SUCCESS;
+  read=1;
+  while(read==1)  /*sort runs,spilling them while there is more to read*/
+  {
+    for(used=0;used<keys&&(read=fn(&buffer[used],arg))==1;++used)
+      if(!KEY_IN_RANGE(buffer[used]))
+	break;
+    if(read<0)
+    {
+      status=E_KEY_SOURCE;
+      break;
+    }
+    if(read==1&&used<keys)  /*a key no file holds*/
+    {
+      status=INV_DATA_PTR;
+      break;
+    }
+    qsort(buffer,used,sizeof(word_t),compare_words);
+    for(index=count=(used>0)?1:0;index<used;++index)  /*drop duplicates*/
+      if(buffer[index]!=buffer[count-1])
+	buffer[count++]=buffer[index];
+    used=count;
+    if(read==0&&runs==0)  /*it all fits in memory*/
+      break;
+    if((more=(FILE **)realloc(run,(runs+1)*sizeof(FILE *)))==NULL)
+    {
+      status=E_NO_MEMORY;
+      break;
+    }
+    run=more;
+    if((status=spill_run(buffer,used,&run[runs]))!=SUCCESS)
+      break;
+    ++runs;
+  }
+  slots=runs;
+  while(status==SUCCESS&&runs>SORT_FAN_IN)  /*a merge pass*/
+  {
+    for(index=used=0;index<runs&&status==SUCCESS;index+=SORT_FAN_IN,++used)
+    {
+      group=(int)((runs-index<SORT_FAN_IN)?runs-index:SORT_FAN_IN);
+      if((out=tmpfile())==NULL)
+	status=E_CREATE_FILE;
+      else if((status=merge_runs(&run[index],group,out,NULL,NULL))==SUCCESS)
+	run[used]=out;  /*its runs are closed,so the slot is free*/
+      else fclose(out);
+    }
+    runs=used;
+  }
+  sorted=buffer;
+  if(status==SUCCESS&&runs>0)  /*the last merge feeds the build*/
+  {
+    free(buffer);
+    if((sorted=(word_t *)malloc((WORD_T_MAX+1UL)*sizeof(word_t)))==NULL)
+      status=E_NO_MEMORY;
+    else status=merge_runs(run,(int)runs,NULL,sorted,&used);
+  }
+  for(index=0;index<slots;++index)
+    if(run[index]!=NULL)
+      fclose(run[index]);
+  free(run);
+  if(status==SUCCESS)
+    status=bp_build(tree,sorted,used,threads);
+  free(sorted);
+  return status;
+}
+
+/****************************************************************************
+   bp_compact: Rewrites the tree in key order at a fill factor,a step at a
+   time,so that an idle loop can run it between requests while lookups,
+   scans and inserts go on.  The keys are read in ascending order,a copy
+   laid out as bp_build() lays it out,its leaves in key order,is written
+   at the end of the file and takes over;once no snapshot is open,the
+   same layout is written again at the front of the file,takes over and
+   the file is cut after it.  The copy starts no nearer than where that
+   layout ends,so the two never meet even when the new layout is the
+   larger,and the file is grown past the copy at once,so that nodes
+   added meanwhile go after it.  A key inserted while the keys are read
+   joins the layout;one inserted later is added to each layout as it
+   takes over,so inserts never start a compaction over.  A B-epsilon tree
+   comes out with empty buffers.  Trees with posting lists and trees in a
+   catalog file cannot be compacted,nor can a string tree;starting a
+   posting list ends a compaction under way with E_NO_COMPACT.
+   -input: The tree handle,the percentage of a node to fill,the pages a
+   step may read or write (0 for no limit) and a pointer to receive 1 once
+			       it is through.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_compact(bp_tree_t *const tree,int fill,size_t pages,
+		    int *const done)
+{
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(done==NULL)
+    return INV_DATA_PTR;
+  *done=0;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(tree->opt.catalog!=NULL)
+    return E_NO_COMPACT;
+  tree->opt.op=BP_OP_OTHER;
+  COUNT_IO(&tree->opt,calls,1UL);
+  status=compact_tree(&tree->opt,&tree->header,fill,
+		      (pages>0)?(unsigned long)pages:~0UL,done);
+  if(status!=SUCCESS||*done!=0)
+    end_compact(&tree->opt);
+  return status;
+}
+
+/****************************************************************************
+    bp_search: Looks a value up in the memtable of an open index file,
+   then in the file.  A value the Bloom filter rules out is not looked for.
+		 -input: The tree handle and the value.
+  -output: SUCCESS if the value is present,E_NOT_FOUND or E_TREE_EMPTY if
+			   not,or another error.
+****************************************************************************/
+status_t bp_search(bp_tree_t *const tree,word_t value)
+{
+  unsigned long start;
+  status_t status;
+  size_t pos;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  start=now_ns();
+  tree->opt.op=BP_OP_SEARCH;
+  COUNT_IO(&tree->opt,calls,1UL);
+  if(find_word(tree->opt.memtable,tree->opt.mem_used,value,&pos)==true)
+    status=SUCCESS;
+  else if(tree->header.root_block!=NO_BLOCK&&
+	  bloom_test(&tree->opt,value)==false)
+  {
+    ++tree->opt.stats.bloom_skips;
+    status=E_NOT_FOUND;
+  }
+  else status=search_value(&tree->opt,&tree->header,value);
+  record_latency(&tree->opt,BP_LAT_SEARCH,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_scan: Calls a function for every key of a range,in ascending order,
+      as the keys were when the scan started.  Inserts made by the
+	callback are not seen by the scan.  The memtable is drained first.
+   -input: The tree handle,the bounds of the range (inclusive),the function
+		      and an argument passed to it.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_scan(bp_tree_t *const tree,word_t low,word_t high,
+		 bp_scan_fn fn,void *arg)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(fn==NULL)
+    return INV_DATA_PTR;
+  start=now_ns();
+  tree->opt.op=BP_OP_SCAN;
+  COUNT_IO(&tree->opt,calls,1UL);
+  if((status=drain_memtable(&tree->opt,&tree->header))==SUCCESS)
+    status=scan_tree(&tree->opt,&tree->header,low,high,fn,arg);
+  record_latency(&tree->opt,BP_LAT_SCAN,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_insert_posting: Adds an id to the posting list of a value,inserting
+   the value first if it is not a key yet.  A list is a chain of extents
+   apart from the nodes,each twice the size of the one before,so a hot key
+   is read in a few large sequential reads;its ids are stored as varint
+   differences,which ascending ids keep short.  Ids are kept in the order
+   they come,repeats included.  Posting lists are not versioned:a snapshot
+			   sees their current state.
+	bp_postings: Calls a function for every id of a value in order.
+   -input: The tree handle,the value,and the id or the function and an
+			     argument passed to it.
+   -output: A status_t value indicating success or an error;bp_postings()
+		 returns E_NOT_FOUND if the value is not a key.
+****************************************************************************/
+status_t bp_insert_posting(bp_tree_t *const tree,word_t value,
+			   unsigned long id)
+{
+  unsigned long start;
+  status_t status;
+  options_t *opt;
+  word_t pos;
+  long block,head;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(!POSTINGS(&tree->header))
+    return E_NO_POSTINGS;
+  if(!KEY_IN_RANGE(value))
+    return INV_DATA_PTR;
+  start=now_ns();
+  opt=&tree->opt;
+  opt->op=BP_OP_INSERT;
+  COUNT_IO(opt,calls,1UL);
+  if(opt->compact!=NULL)  /*a posting list cannot be moved*/
+    opt->compact->failed=E_NO_COMPACT;
+  bloom_add(opt,value);
+  status=locate_key(opt,&tree->header,value,&block,&pos);
+  if(status==E_NOT_FOUND||status==E_TREE_EMPTY)  /*a new key*/
+  {
+    if(status==E_TREE_EMPTY)
+      status=insert_value(&tree->header,opt,value);
+    else if((status=place_value(opt,&tree->header,value))==SUCCESS)
+	   ++opt->epoch;  /*past any buffers:the key must be in a node*/
+    if(status==SUCCESS)
+      status=locate_key(opt,&tree->header,value,&block,&pos);
+  }
+  if(status==SUCCESS)
+  {
+    head=opt->p->ref[pos];
+    if((status=append_posting(opt,&head,id))==SUCCESS&&
+       head!=opt->p->ref[pos])  /*the list has just been started*/
+    {
+      opt->p->ref[pos]=head;
+      if((status=write_block(opt,&tree->header,block,opt->p))==SUCCESS)
+	++opt->epoch;
+    }
+  }
+  if(status==SUCCESS)
+    status=flush_file(opt);
+  record_latency(opt,BP_LAT_INSERT,start);
+  return status;
+}
+
+status_t bp_postings(bp_tree_t *const tree,word_t value,bp_posting_fn fn,
+		     void *arg)
+{
+  unsigned long start;
+  status_t status;
+  size_t held;
+  word_t pos;
+  long block;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(fn==NULL)
+    return INV_DATA_PTR;
+  if(!POSTINGS(&tree->header))
+    return E_NO_POSTINGS;
+  start=now_ns();
+  tree->opt.op=BP_OP_SEARCH;
+  COUNT_IO(&tree->opt,calls,1UL);
+  status=locate_key(&tree->opt,&tree->header,value,&block,&pos);
+  if(status==SUCCESS)
+    status=walk_postings(&tree->opt,tree->opt.p->ref[pos],fn,arg);
+  else if(status==E_NOT_FOUND||status==E_TREE_EMPTY)  /*buffered keys*/
+	 status=(find_word(tree->opt.memtable,tree->opt.mem_used,value,
+			   &held)==true)?SUCCESS:
+		search_value(&tree->opt,&tree->header,value);
+  record_latency(&tree->opt,BP_LAT_SEARCH,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_create_strings: Creates a new index file of byte-string keys of up to
+   BP_STRING_MAX bytes.  Its pages are slotted:each stores the prefix its
+   keys share once,and a leaf split sends up only as much of the right
+   half's first key as tells it from the left half's last one,so the
+   fanout stays high for keys such as user ids and paths.  bp_open()
+	     recognises such a file by the size of its blocks.
+   -input: The index file name and a pointer to receive the tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_create_strings(const char *const name,bp_tree_t **const tree)
+{
+  return new_tree(name,false,STRING_PAGE_SIZE,NULL,tree);
+}
+
+/****************************************************************************
+   bp_catalog_create/bp_catalog_open/bp_catalog_tree/bp_catalog_close: Keep
+   many trees in one file.  The catalog pages map the name of every tree to
+   its header,which holds its root and the size of its blocks;the trees
+   share one open file and its buffer,and their nodes,all at absolute
+   offsets,are appended to the same end,so a set of small indexes costs
+   one open and one descriptor.  A tree handle of a catalog writes its
+   header into its catalog entry,and closing it leaves the file open.
+   -input: The file name and a pointer to receive the catalog handle;for a
+   tree,the catalog handle,the tree name,the kind of a new tree and a
+			pointer to receive the tree handle.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+#define CATALOG_BUFFER_SIZE 65536  /*the buffer of a catalog file*/
+
+static status_t new_catalog(const char *const name,boolean_t file_exists,
+			    bp_catalog_t **const catalog)
+{
+  bp_catalog_t *cat;
+  catalog_t page;
+  status_t status;
+
+  if(name==NULL||catalog==NULL)
+    return INV_DATA_PTR;
+  *catalog=NULL;
+  if((cat=(bp_catalog_t *)malloc(sizeof(bp_catalog_t)))==NULL)
+    return E_NO_MEMORY;
+  strncpy(cat->name,name,FILE_BUFFER_SIZE-1);
+  cat->name[FILE_BUFFER_SIZE-1]='\0';
+  cat->trees=0;
+  status=SUCCESS;
+  if((cat->iop=fopen(cat->name,(file_exists==true)?"r+b":"w+b"))==NULL)
+    status=(file_exists==true)?E_OPEN_FILE:E_CREATE_FILE;
+  else if(setvbuf(cat->iop,NULL,_IOFBF,CATALOG_BUFFER_SIZE)!=0)
+    status=E_NO_MEMORY;
+  else if(file_exists==true)
+  {
+    if(fread(&cat->header,sizeof(header_t),1,cat->iop)!=1)
+      status=E_READ_FILE;
+    else if(cat->header.header_size!=sizeof(header_t)||
+	    !CATALOG(&cat->header))
+      status=E_INCOMPATIBLE_VERSION;
+  }
+  else  /*the header and an empty catalog page*/
+  {
+    cat->header.header_size=sizeof(header_t);
+    cat->header.block_size=CATALOG_SIZE;
+    cat->header.tree_order=TREE_ORDER;
+    cat->header.root_block=(long)sizeof(header_t);
+    memset(&page,0,sizeof(catalog_t));
+    page.tag=CATALOG_TAG;
+    page.next=NO_BLOCK;
+    if(fwrite(&cat->header,sizeof(header_t),1,cat->iop)!=1||
+       fwrite(&page,sizeof(catalog_t),1,cat->iop)!=1||fflush(cat->iop)==EOF)
+      status=E_WRITE_FILE;
+  }
+  if(status!=SUCCESS)
+  {
+    if(cat->iop!=NULL)
+      fclose(cat->iop);
+    free(cat);
+    return status;
+  }
+  *catalog=cat;
+  return SUCCESS;
+}
+
+status_t bp_catalog_create(const char *const name,
+			   bp_catalog_t **const catalog)
+{
+  return new_catalog(name,false,catalog);
+}
+
+status_t bp_catalog_open(const char *const name,bp_catalog_t **const catalog)
+{
+  return new_catalog(name,true,catalog);
+}
+
+status_t bp_catalog_tree(bp_catalog_t *const catalog,const char *const name,
+			 bp_kind_t kind,bp_tree_t **const tree)
+{
+  static const size_t kind_size[]={ PLAIN_BLOCK_SIZE,sizeof(node_t),
+				    COUNTED_BLOCK_SIZE,POSTING_BLOCK_SIZE,
+				    STRING_PAGE_SIZE };
+
+  if(catalog==NULL)
+    return INV_OPT_PTR;
+  if(kind<BP_PLAIN||kind>BP_STRINGS)
+    return INV_DATA_PTR;
+  return new_tree(name,true,kind_size[kind],catalog,tree);
+}
+
+status_t bp_catalog_close(bp_catalog_t *const catalog)
+{
+  status_t status;
+
+  if(catalog==NULL)
+    return INV_OPT_PTR;
+  if(catalog->trees>0)  /*a tree handle still uses the file*/
+    return E_CLOSE_FILE;
+  status=(fclose(catalog->iop)==EOF)?E_CLOSE_FILE:SUCCESS;
+  free(catalog);
+  return status;
+}
+
+/****************************************************************************
+   attach_tree: Finds a tree in the catalog of a file,or adds it to the
+   first catalog page with room,chaining a new page at the end of the file
+   if there is none.  The tree takes the file of the catalog and keeps
+		      its header in its catalog entry.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,with the block size of a new tree,the catalog and
+				the tree name.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t attach_tree(options_t *const opt,header_t *const h,
+			    bp_catalog_t *const cat,const char *const name)
+{
+  long block,last,at;
+  catalog_t page;
+  word_t index;
+
+  opt->iop=cat->iop;
+  for(last=NO_BLOCK,block=cat->header.root_block;block!=NO_BLOCK;
+      last=block,block=page.next)
+  {
+    if(seek_file(opt,block,SEEK_SET)!=0)
+      return E_MOVE_FILE;
+    if(fread(&page,sizeof(catalog_t),1,opt->iop)!=1||page.tag!=CATALOG_TAG)
+      return E_READ_FILE;
+    for(index=0;index<page.entries;++index)
+      if(strcmp(page.entry[index].name,name)==0)
+	break;
+    if(index<page.entries||page.entries<CATALOG_ENTRIES)
+      break;
+  }
+  if(block==NO_BLOCK)  /*every page is full:chain a new one*/
+  {
+    if(seek_file(opt,0L,SEEK_END)!=0||(block=ftell(opt->iop))==-1L)
+      return E_MOVE_FILE;
+    page.next=block;
+    if(seek_file(opt,last+(long)offsetof(catalog_t,next),SEEK_SET)!=0)
+      return E_MOVE_FILE;
+    if(fwrite(&page.next,sizeof(long),1,opt->iop)!=1)
+      return E_WRITE_FILE;
+    memset(&page,0,sizeof(catalog_t));
+    page.tag=CATALOG_TAG;
+    page.next=NO_BLOCK;
+    index=0;
+  }
+  at=block+(long)offsetof(catalog_t,entry)+
+    (long)(index*sizeof(catalog_entry_t));
+  if(index==page.entries)  /*a new tree*/
+  {
+    memset(&page.entry[index],0,sizeof(catalog_entry_t));
+    strcpy(page.entry[index].name,name);
+    memcpy(&page.entry[index].header,h,sizeof(header_t));
+    ++page.entries;
+    if(seek_file(opt,block,SEEK_SET)!=0)
+      return E_MOVE_FILE;
+    if(fwrite(&page,sizeof(catalog_t),1,opt->iop)!=1)
+      return E_WRITE_FILE;
+    COUNT_IO(opt,bytes_written,(unsigned long)sizeof(catalog_t));
+    if(fflush(opt->iop)==EOF)
+      return E_WRITE_FILE;
+  }
+  else if(page.entry[index].header.header_size!=sizeof(header_t))
+    return E_INCOMPATIBLE_VERSION;
+  memcpy(h,&page.entry[index].header,sizeof(header_t));
+  opt->header_at=at+(long)offsetof(catalog_entry_t,header);
+  opt->catalog=cat;
+  ++cat->trees;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   bp_insert_string/bp_search_string/bp_scan_strings: Insert a key into a
+   string index file,look it up,and call a function for every key of a
+   range (inclusive) in ascending order.  String trees have no memtable,
+			  snapshots or postings.
+   -input: The tree handle,the key and its length (or the bounds,and the
+		 function and an argument passed to it).
+  -output: A status_t value indicating success or an error;the search
+	       returns E_NOT_FOUND or E_TREE_EMPTY if not found.
+****************************************************************************/
+status_t bp_insert_string(bp_tree_t *const tree,const void *key,
+			  size_t length)
+{
+  return store_string(tree,key,length,NULL,0,false);
+}
+
+status_t bp_search_string(bp_tree_t *const tree,const void *key,
+			  size_t length)
+{
+  return bp_get_string(tree,key,length,NULL,NULL);
+}
+
+status_t bp_scan_strings(bp_tree_t *const tree,const void *low,
+			 size_t low_length,const void *high,
+			 size_t high_length,bp_string_fn fn,void *arg)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(fn==NULL||(low==NULL&&low_length>0)||(high==NULL&&high_length>0))
+    return INV_DATA_PTR;
+  if(!STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  start=now_ns();
+  tree->opt.op=BP_OP_SCAN;
+  COUNT_IO(&tree->opt,calls,1UL);
+  status=scan_strings(&tree->opt,&tree->header,(const byte_t *)low,
+		      low_length,(const byte_t *)high,high_length,fn,arg);
+  record_latency(&tree->opt,BP_LAT_SCAN,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_put_string/bp_get_string: Store a key of a string index file with a
+   value,replacing the value it had,and pass the value of a key to a
+   function,in pieces if it is long.  A value of up to VALUE_INLINE bytes
+   stays in the leaf;a longer one is written to overflow pages in one run
+   at the end of the file and the leaf keeps only their block,so leaves
+   stay dense for scans and a long value is read sequentially,only when
+   it is asked for.  A replaced long value leaves its pages unused.
+   -input: The tree handle,the key and its length,and the value and its
+	   length (or the function and an argument passed to it).
+   -output: A status_t value indicating success or an error;the get
+	       returns E_NOT_FOUND or E_TREE_EMPTY if not found.
+****************************************************************************/
+status_t bp_put_string(bp_tree_t *const tree,const void *key,size_t length,
+		       const void *value,size_t value_length)
+{
+  if(value==NULL&&value_length>0)
+    return INV_DATA_PTR;
+  return store_string(tree,key,length,value,value_length,true);
+}
+
+status_t bp_get_string(bp_tree_t *const tree,const void *key,size_t length,
+		       bp_value_fn fn,void *arg)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(key==NULL&&length>0)
+    return INV_DATA_PTR;
+  if(!STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  start=now_ns();
+  tree->opt.op=BP_OP_SEARCH;
+  COUNT_IO(&tree->opt,calls,1UL);
+  status=search_string(&tree->opt,&tree->header,(const byte_t *)key,length,
+		       fn,arg);
+  record_latency(&tree->opt,BP_LAT_SEARCH,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_value_log/bp_log_gc: Send the long values of later puts through this
+   handle to a log of segment files next to a string index file,and
+   collect the log.  The leaf keeps only the offset of a value,so a put of
+   a long value costs one sequential append and splits never move it.  The
+   collector takes the oldest segment record by record,appends the values
+   the tree still points at to the log and removes the segment once it is
+   through;it stops after looking at a number of bytes,so an idle loop can
+   run it in steps between requests.  Values in the log are read whether
+		       or not it takes new ones.
+   -input: The tree handle,and the log bytes a step may look at.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_value_log(bp_tree_t *const tree)
+{
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(!STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if((status=open_log(&tree->opt))!=SUCCESS)
+    return status;
+  tree->opt.log_on=true;
+  return SUCCESS;
+}
+
+status_t bp_log_gc(bp_tree_t *const tree,size_t bytes)
+{
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(!STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  tree->opt.op=BP_OP_OTHER;
+  if((status=open_log(&tree->opt))!=SUCCESS)
+    return status;
+  return gc_log(&tree->opt,&tree->header,bytes);
+}
+
+/****************************************************************************
+   store_string: Stores a key of a string index file,and its value unless
+   the key is there and the value is not to be replaced.
+   -input: The tree handle,the key and its length,the value and its length
+			 and whether to replace it.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t store_string(bp_tree_t *const tree,const void *key,
+			     size_t length,const void *value,
+			     size_t value_length,boolean_t replace)
+{
+  unsigned long start;
+  status_t status;
+  entry_t item;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(key==NULL&&length>0)
+    return INV_DATA_PTR;
+  if(!STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(length>BP_STRING_MAX)
+    return E_KEY_TOO_LONG;
+  start=now_ns();
+  tree->opt.op=BP_OP_INSERT;
+  COUNT_IO(&tree->opt,calls,1UL);
+  memcpy(item.key,key,length);
+  item.length=length;
+  item.value_length=0;
+  item.logged=false;
+  item.child=NO_BLOCK;
+  status=SUCCESS;
+  if(value_length>VALUE_INLINE&&tree->opt.log_on==true)
+  {
+    status=append_log(&tree->opt,item.key,length,(const byte_t *)value,
+		      value_length,&item.child);
+    item.logged=true;
+  }
+  else if(value_length>VALUE_INLINE)
+    status=write_overflow(&tree->opt,(const byte_t *)value,value_length,
+			  &item.child);
+  else
+  {
+    memcpy(item.value,value,value_length);
+    item.value_length=value_length;
+  }
+  /*the value is in the log before the leaf points at it*/
+  if(status==SUCCESS&&item.logged==true&&fflush(tree->opt.log)==EOF)
+    status=E_WRITE_FILE;
+  if(status==SUCCESS&&
+     (status=insert_string(&tree->opt,&tree->header,&item,replace))==SUCCESS)
+    status=flush_file(&tree->opt);
+  record_latency(&tree->opt,BP_LAT_INSERT,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_rank/bp_select/bp_count: The number of keys below a value,the key
+   with a given number of keys below it,and the number of keys in a range
+   (inclusive).  On a counted file each costs one descent (two for
+   bp_count());on the others they scan the keys.  The memtable is drained
+   first.  bp_select() returns E_NOT_FOUND past the last key.
+   -input: The tree handle,the value,rank or bounds,and a pointer to
+			   receive the answer.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_rank(bp_tree_t *const tree,word_t value,unsigned long *const rank)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(rank==NULL)
+    return INV_DATA_PTR;
+  start=now_ns();
+  tree->opt.op=BP_OP_SEARCH;
+  COUNT_IO(&tree->opt,calls,1UL);
+  if((status=drain_memtable(&tree->opt,&tree->header))==SUCCESS)
+    status=rank_value(&tree->opt,&tree->header,value,false,rank);
+  record_latency(&tree->opt,BP_LAT_SEARCH,start);
+  return status;
+}
+
+status_t bp_select(bp_tree_t *const tree,unsigned long rank,
+		   word_t *const value)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(value==NULL)
+    return INV_DATA_PTR;
+  start=now_ns();
+  tree->opt.op=BP_OP_SEARCH;
+  COUNT_IO(&tree->opt,calls,1UL);
+  if((status=drain_memtable(&tree->opt,&tree->header))==SUCCESS)
+    status=select_value(&tree->opt,&tree->header,rank,value);
+  record_latency(&tree->opt,BP_LAT_SEARCH,start);
+  return status;
+}
+
+status_t bp_count(bp_tree_t *const tree,word_t low,word_t high,
+		  unsigned long *const count)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  if(count==NULL)
+    return INV_DATA_PTR;
+  start=now_ns();
+  tree->opt.op=BP_OP_SEARCH;
+  COUNT_IO(&tree->opt,calls,1UL);
+  if((status=drain_memtable(&tree->opt,&tree->header))==SUCCESS)
+    status=count_values(&tree->opt,&tree->header,low,high,count);
+  record_latency(&tree->opt,BP_LAT_SEARCH,start);
+  return status;
+}
+
+/****************************************************************************
+   bp_snapshot_open/bp_snapshot_close: Pins the current version of a tree
+   for cursors and releases it.  See open_snapshot().  Opening a snapshot
+	       drains the memtable,so that it sees every insert.
+	-input: The tree handle and the snapshot (or a pointer to it).
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_snapshot_open(bp_tree_t *const tree,bp_snapshot_t **const snap)
+{
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  tree->opt.op=BP_OP_SCAN;
+  if((status=drain_memtable(&tree->opt,&tree->header))!=SUCCESS)
+    return status;
+  return open_snapshot(&tree->opt,&tree->header,snap);
+}
+
+status_t bp_snapshot_close(bp_tree_t *const tree,bp_snapshot_t *const snap)
+{
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  tree->opt.op=BP_OP_SCAN;
+  return close_snapshot(&tree->opt,snap);
+}
+
+/****************************************************************************
+  bp_cursor_open/bp_cursor_next/bp_cursor_close: Walks the keys of a
+     snapshot in ascending order,starting at the first key >= low.
+     bp_cursor_next() returns E_END_OF_SCAN after the last key.  The time
+     spent in the calls of a cursor is recorded as one scan once it is
+     closed,whether it reached the end or its caller stopped short.  A
+     cursor must be closed before the snapshot it reads from,and so before
+			    the index file.
+   -input: The tree handle,the snapshot,the lower bound and a pointer to
+	     receive the cursor,or the cursor and the next key.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_cursor_open(bp_tree_t *const tree,bp_snapshot_t *const snap,
+			word_t low,bp_cursor_t **const cur)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(cur==NULL)
+    return INV_DATA_PTR;
+  start=now_ns();
+  if((*cur=(cursor_t *)malloc(sizeof(cursor_t)))==NULL)
+    return E_NO_MEMORY;
+  tree->opt.op=BP_OP_SCAN;
+  COUNT_IO(&tree->opt,calls,1UL);
+  if((status=open_cursor(&tree->opt,&tree->header,snap,low,*cur))!=SUCCESS)
+  {
+    free(*cur);
+    *cur=NULL;
+  }
+  else
+  {
+    (*cur)->opt=&tree->opt;
+    (*cur)->elapsed_ns=now_ns()-start;
+  }
+  return status;
+}
+
+status_t bp_cursor_next(bp_tree_t *const tree,bp_cursor_t *const cur,
+			word_t *const value)
+{
+  unsigned long start;
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(cur==NULL)
+    return INV_DATA_PTR;
+  start=now_ns();
+  tree->opt.op=BP_OP_SCAN;
+  status=next_cursor(&tree->opt,&tree->header,cur,value);
+  cur->elapsed_ns+=now_ns()-start;
+  return status;
+}
+
+void bp_cursor_close(bp_cursor_t *const cur)
+{
+  if(cur!=NULL)
+    record_latency(cur->opt,BP_LAT_SCAN,now_ns()-cur->elapsed_ns);
+  free(cur);
+  return;
+}
+
+/****************************************************************************
+   bp_memtable: Sets the number of inserts an index file holds in memory
+   before it merges them into the file in one sorted pass;0 turns the
+   memtable off.  The inserts held are lost if the program dies before
+		 bp_flush() or bp_close() drains them.
+	bp_flush: Drains the memtable into the index file now,and writes
+	back the root buffer of a B-epsilon tree,which holds its inserts
+			 in memory the same way.
+	       -input: The tree handle and the capacity in keys.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_memtable(bp_tree_t *const tree,size_t keys)
+{
+  status_t status;
+  word_t *table;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  tree->opt.op=BP_OP_INSERT;
+  if((status=drain_memtable(&tree->opt,&tree->header))!=SUCCESS)
+    return status;
+  table=NULL;
+  if(keys>0&&(table=(word_t *)malloc(keys*sizeof(word_t)))==NULL)
+    return E_NO_MEMORY;
+  free(tree->opt.memtable);
+  tree->opt.memtable=table;
+  tree->opt.mem_size=keys;
+  return SUCCESS;
+}
+
+status_t bp_flush(bp_tree_t *const tree)
+{
+  status_t status;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  tree->opt.op=BP_OP_INSERT;
+  if((status=drain_memtable(&tree->opt,&tree->header))!=SUCCESS||
+     (status=write_top(&tree->opt,&tree->header))!=SUCCESS)
+    return status;
+  return flush_file(&tree->opt);
+}
+
+/****************************************************************************
+   bp_bloom: Builds a Bloom filter of the keys of an open index file,sized
+   for the number of keys the file is expected to reach;0 drops the filter.
+   The build reads every node once.  bp_insert() and bp_insert_batch() add
+   their keys as they go,and bp_search() answers E_NOT_FOUND without a read
+   for about 99% of the absent keys while the file holds no more keys than
+   planned;past that the share falls.  The filter lives only in memory,so
+		 it has to be built again after bp_open().
+	  -input: The tree handle and the planned number of keys.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static int bloom_key(word_t value,void *arg);
+
+status_t bp_bloom(bp_tree_t *const tree,size_t keys)
+{
+  unsigned long bits;
+  status_t status;
+  size_t index;
+
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(STRINGS(&tree->header))
+    return E_KEY_TYPE;
+  free(tree->opt.bloom);
+  tree->opt.bloom=NULL;
+  tree->opt.bloom_mask=0UL;
+  if(keys==0)
+    return SUCCESS;
+  if(keys>(size_t)WORD_T_MAX+1)
+    keys=(size_t)WORD_T_MAX+1;  /*no file holds more*/
+  for(bits=64UL;bits<(unsigned long)keys*BLOOM_BITS_PER_KEY;bits<<=1)
+    ;  /*a power of two,so that a hash is masked into range*/
+  if((tree->opt.bloom=(unsigned char *)calloc(bits/8UL,1))==NULL)
+    return E_NO_MEMORY;
+  tree->opt.bloom_mask=bits-1UL;
+  tree->opt.op=BP_OP_OTHER;
+  for(index=0;index<tree->opt.mem_used;++index)
+    bloom_add(&tree->opt,tree->opt.memtable[index]);
+  if((status=scan_tree(&tree->opt,&tree->header,0,(word_t)WORD_T_MAX,
+		       bloom_key,&tree->opt))!=SUCCESS)
+  {
+    free(tree->opt.bloom);
+    tree->opt.bloom=NULL;
+  }
+  return status;
+}
+
+/****************************************************************************
+   bloom_add/bloom_test: Sets the bits of a key in the Bloom filter,or
+   checks them.  The probes come from two halves of one 32-bit hash (double
+		   hashing),so a key costs a single mix.
+	-input: A constant pointer to B+ tree's options and the key.
+   -output: None,or false if the key is certainly not in the tree (true
+			      without a filter).
+****************************************************************************/
+static unsigned long bloom_hash(word_t value)
+{
+  unsigned long x;
+
+  x=((unsigned long)value+0x9E3779B9UL)&0xFFFFFFFFUL;
+  x=((x^(x>>16))*0x85EBCA6BUL)&0xFFFFFFFFUL;
+  x=((x^(x>>13))*0xC2B2AE35UL)&0xFFFFFFFFUL;
+  return x^(x>>16);
+}
+
+static void bloom_add(options_t *const opt,word_t value)
+{
+  unsigned long x,step,bit;
+  int probe;
+
+  if(opt->bloom==NULL)
+    return;
+  x=bloom_hash(value);
+  step=(x>>16)|1UL;  /*odd,so the probes of a key differ*/
+  for(probe=0;probe<BLOOM_PROBES;++probe,x+=step)
+  {
+    bit=x&opt->bloom_mask;
+    opt->bloom[bit>>3]|=(unsigned char)(1U<<(bit&7UL));
+  }
+  return;
+}
+
+static boolean_t bloom_test(const options_t *const opt,word_t value)
+{
+  unsigned long x,step,bit;
+  int probe;
+
+  if(opt->bloom==NULL)
+    return true;
+  x=bloom_hash(value);
+  step=(x>>16)|1UL;
+  for(probe=0;probe<BLOOM_PROBES;++probe,x+=step)
+  {
+    bit=x&opt->bloom_mask;
+    if((opt->bloom[bit>>3]&(1U<<(bit&7UL)))==0)
+      return false;
+  }
+  return true;
+}
+
+/****************************************************************************
+	  bloom_key: The scan_tree() callback of bp_bloom().
+   -input: The key and a constant pointer to B+ tree's options.
+		-output: Zero,so that the scan goes on.
+****************************************************************************/
+static int bloom_key(word_t value,void *arg)
+{
+  bloom_add((options_t *)arg,value);
+  return 0;
+}
+
+/****************************************************************************
+	 bp_stats: Returns the I/O counters of an open index file.
+	-input: The tree handle and a pointer to receive the counters.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_stats(bp_tree_t *const tree,bp_stats_t *const stats)
+{
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(stats==NULL)
+    return INV_DATA_PTR;
+  memcpy(stats,&tree->opt.stats,sizeof(bp_stats_t));
+  return SUCCESS;
+}
+
+/****************************************************************************
+   bp_latency/bp_latency_reset: Returns a copy of the latency histograms of
+		  an open index file,or clears them.
+   -input: The tree handle and a pointer to receive the histograms.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+status_t bp_latency(bp_tree_t *const tree,bp_latency_t *const lat)
+{
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  if(lat==NULL)
+    return INV_DATA_PTR;
+  memcpy(lat,&tree->opt.latency,sizeof(bp_latency_t));
+  return SUCCESS;
+}
+
+status_t bp_latency_reset(bp_tree_t *const tree)
+{
+  if(tree==NULL)
+    return INV_OPT_PTR;
+  memset(&tree->opt.latency,0,sizeof(bp_latency_t));
+  return SUCCESS;
+}
+
+/****************************************************************************
+   bp_latency_merge: Adds the histograms of one copy to another,e.g. the
+			copies taken by several threads.
+     -input: The histograms to add to and the histograms to add.
+			      -output: None.
+****************************************************************************/
+void bp_latency_merge(bp_latency_t *const into,
+		      const bp_latency_t *const from)
+{
+  bp_histogram_t *to;
+  const bp_histogram_t *add;
+  int which,index;
+
+  for(which=0;which<BP_LATS;++which)
+  {
+    to=&into->hist[which];
+    add=&from->hist[which];
+    to->count+=add->count;
+    to->sum_ns+=add->sum_ns;
+    if(add->max_ns>to->max_ns)
+      to->max_ns=add->max_ns;
+    for(index=0;index<BP_HIST_BUCKETS;++index)
+      to->bucket[index]+=add->bucket[index];
+  }
+  return;
+}
+
+/****************************************************************************
+   bucket_of/bucket_top: Maps a latency to its histogram bucket and a
+   bucket to the highest latency it holds.  Below 2^BP_HIST_SUB_BITS ns
+   every value has a bucket of its own;above,every power of two is split
+   into 2^BP_HIST_SUB_BITS buckets,so a bucket is within 1/16 of the
+			       values in it.
+	   -input: The latency in ns,or the index of the bucket.
+		 -output: The bucket,or the latency.
+****************************************************************************/
+static int bucket_of(unsigned long ns)
+{
+  unsigned long sub;
+  int top,index;
+
+  sub=1UL<<BP_HIST_SUB_BITS;
+  if(ns<sub)
+    return (int)ns;
+  for(top=BP_HIST_SUB_BITS;top<(int)(8*sizeof(unsigned long))-1&&
+      (ns>>(top+1))!=0;++top)
+    ;  /*top is the position of the highest bit that is set*/
+  index=(top-BP_HIST_SUB_BITS+1)*(int)sub+
+	(int)((ns>>(top-BP_HIST_SUB_BITS))&(sub-1UL));
+  return (index<BP_HIST_BUCKETS)?index:BP_HIST_BUCKETS-1;
+}
+
+static unsigned long bucket_top(int index)
+{
+  unsigned long sub,group;
+
+  sub=1UL<<BP_HIST_SUB_BITS;
+  if((unsigned long)index<sub)
+    return (unsigned long)index;
+  group=(unsigned long)index/sub;
+  return ((sub+1UL+(unsigned long)index%sub)<<(group-1UL))-1UL;
+}
+
+/****************************************************************************
+   bp_percentile: Estimates a percentile of a latency histogram.
+     -input: The histogram and the fraction wanted (0.99 for p99).
+   -output: The highest latency in the bucket of that rank,in ns (never
+			above the largest sample).
+****************************************************************************/
+unsigned long bp_percentile(const bp_histogram_t *const hist,double fraction)
+{
+  unsigned long rank,seen,top;
+  int index;
+
+  if(hist==NULL||hist->count==0)
+    return 0UL;
+  rank=(unsigned long)(fraction*(double)hist->count+0.5);
+  if(rank<1UL)
+    rank=1UL;
+  seen=0UL;
+  for(index=0;index<BP_HIST_BUCKETS-1;++index)
+    if((seen+=hist->bucket[index])>=rank)
+      break;
+  top=bucket_top(index);
+  return (top<hist->max_ns)?top:hist->max_ns;
+}
+
+/****************************************************************************
+   bp_latency_print: Dumps a summary line for every latency histogram.
+     -input: The stream to print to and the histograms.
+			      -output: None.
+****************************************************************************/
+void bp_latency_print(FILE *const iop,const bp_latency_t *const lat)
+{
+  static const char *const name[BP_LATS]=
+    { "insert","search","scan","split","flush","batch" };
+  const bp_histogram_t *hist;
+  int which;
+
+  fprintf(iop,"%-8s%10s%10s%10s%10s%10s%10s%12s\n","latency","count",
+	  "mean ns","p50","p90","p99","p99.9","max");
+  for(which=0;which<BP_LATS;++which)
+  {
+    hist=&lat->hist[which];
+    fprintf(iop,"%-8s%10lu%10.0f%10lu%10lu%10lu%10lu%12lu\n",name[which],
+	    hist->count,(hist->count!=0)?hist->sum_ns/(double)hist->count:0.0,
+	    bp_percentile(hist,0.50),bp_percentile(hist,0.90),
+	    bp_percentile(hist,0.99),bp_percentile(hist,0.999),hist->max_ns);
+  }
+  return;
+}
+
+/****************************************************************************
+	   bp_strerror: Returns the message for a status_t value.
+			 -input: The status_t value.
+		    -output: A constant string.
+****************************************************************************/
+const char *bp_strerror(status_t status)
+{
+  if(status>SUCCESS||-status>=(int)(sizeof(error_msg)/sizeof(*error_msg)))
+    return "An unknown error has occured.";
+  return error_msg[-status];
+}
+
+/****************************************************************************
+ reallocate_block: Reserves memory for one node (which fits to a disk block)
+	of a B+ tree or resizes it to fit current tree's block size.
+	  -input: A constant pointer to the B+ tree's options.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t reallocate_block(options_t *const opt)
+{
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if((opt->p=(node_t *)realloc(opt->p,sizeof(node_t)))==NULL)
+    return E_NO_MEMORY;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   deallocate_block: Deallocates the memory reserved from allocate_block().
+	    -input: A constant pointer to the B+ tree's options.
+	  -output: A status_t value indicating sucess or an error.
+****************************************************************************/
+static status_t deallocate_block(options_t *const opt)
+{
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(opt->p!=NULL)
+    free(opt->p);
+  opt->p=NULL;
+  return SUCCESS;
+}
+
+/****************************************************************************
+	    open_tree: Opens/constructs the B+ tree in the disk.
+  -input: A constant pointer to B+ tree's options and a constant pointer to
+			    the B+ tree's header.
+	  -output: A status_t value indicating sucess or an error.
+****************************************************************************/
+static status_t open_tree(options_t *const opt,header_t *const h)
+{
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(h==NULL)
+    return INV_HEADER_PTR;
+  if(opt->file_exists==true)
+  {
+    if((opt->iop=fopen(opt->name,"r+b"))==NULL)
+      return E_OPEN_FILE;
+    if(fread(h,sizeof(header_t),1,opt->iop)!=1)
+      return E_READ_FILE;
+    if(h->header_size!=sizeof(header_t)||h->tree_order>TREE_ORDER||
+       (h->block_size!=sizeof(node_t)&&h->block_size!=PLAIN_BLOCK_SIZE&&
+	h->block_size!=POSTING_BLOCK_SIZE&&h->block_size!=COUNTED_BLOCK_SIZE&&
+	h->block_size!=STRING_PAGE_SIZE))
+      return E_INCOMPATIBLE_VERSION;
+  }
+  else
+  {
+    if((opt->iop=fopen(opt->name,"w+b"))==NULL)
+      return E_CREATE_FILE;
+    return write_header(opt,h);
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+    write_header: Writes the header to the front of the index file and
+		      flushes it.
+  -input: A constant pointer to B+ tree's options and a constant pointer to
+			    the B+ tree's header.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t write_header(options_t *const opt,header_t *const h)
+{
+  if(seek_file(opt,opt->header_at,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(h,sizeof(header_t),1,opt->iop)!=1)
+    return E_WRITE_FILE;
+  COUNT_IO(opt,bytes_written,(unsigned long)sizeof(header_t));
+  return flush_file(opt);
+}
+
+/****************************************************************************
+   seek_file/flush_file: fseek() and fflush() on the index file,counted in
+			  the I/O statistics.
+  -input: A constant pointer to B+ tree's options,and the arguments of
+			      fseek().
+	-output: The result of fseek(),or a status_t value.
+****************************************************************************/
+static int seek_file(options_t *const opt,long offset,int whence)
+{
+  COUNT_IO(opt,seeks,1UL);
+  return fseek(opt->iop,offset,whence);
+}
+
+static status_t flush_file(options_t *const opt)
+{
+  unsigned long start;
+  int result;
+
+  start=now_ns();
+  COUNT_IO(opt,flushes,1UL);
+  TRACE1(flush,(unsigned int)opt->key);
+  result=fflush(opt->iop);
+  record_latency(opt,BP_LAT_FLUSH,start);
+  return (result==EOF)?E_WRITE_FILE:SUCCESS;
+}
+
+/****************************************************************************
+   now_ns: Reads the monotonic clock,or the processor clock where there is
+			       none.
+			      -input: None.
+		   -output: The time in nanoseconds.
+****************************************************************************/
+static unsigned long now_ns(void)
+{
+#if defined(CLOCK_MONOTONIC)
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  return (unsigned long)now.tv_sec*1000000000UL+(unsigned long)now.tv_nsec;
+#else
+  return (unsigned long)((double)clock()*(1e9/CLOCKS_PER_SEC));
+#endif
+}
+
+/****************************************************************************
+   record_latency: Adds the time since a start to one of the histograms.
+  -input: A constant pointer to the B+ tree's options,the histogram and the
+				start time.
+			      -output: None.
+****************************************************************************/
+static void record_latency(options_t *const opt,bp_lat_t which,
+			   unsigned long start_ns)
+{
+  bp_histogram_t *const hist=&opt->latency.hist[which];
+  unsigned long ns;
+
+  ns=now_ns()-start_ns;
+  ++hist->count;
+  hist->sum_ns+=(double)ns;
+  if(ns>hist->max_ns)
+    hist->max_ns=ns;
+  ++hist->bucket[bucket_of(ns)];
+  return;
+}
+
+/****************************************************************************
+	      close_tree: Closes a file containing a B+ tree.
+	   -input: A constant pointer to the B+ tree's options.
+	 -output: A status_t value indicating sucess or an error.
+****************************************************************************/
+static void free_versions(options_t *const opt);
+
+static status_t close_tree(options_t *const opt)
+{
+  snapshot_t *snap;
+
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  while((snap=opt->snapshots)!=NULL)  /*snapshots die with the file*/
+  {
+    opt->snapshots=snap->next;
+    free(snap);
+  }
+  free_versions(opt);
+  end_compact(opt);
+  if(opt->catalog!=NULL)  /*the file stays open for the other trees*/
+  {
+    --opt->catalog->trees;
+    opt->catalog=NULL;
+    if(fflush(opt->iop)==EOF)
+      return E_WRITE_FILE;
+  }
+  else if(opt->iop!=NULL&&fclose(opt->iop)==EOF)
+    return E_CLOSE_FILE;
+  opt->iop=NULL;  /*just a precaution*/
+  return SUCCESS;
+}
+
+/****************************************************************************
+	  read_block: Reads the node stored at a block of the index file.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's header,the block to read and the node to fill.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_block(options_t *const opt,header_t *const h,
+			   long block,node_t *const node)
+{
+  if(seek_file(opt,block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fread(node,h->block_size,1,opt->iop)!=1)
+    return E_READ_FILE;
+  if(!BUFFERED(h))
+    node->msgs_used=0;  /*plain blocks stop short of the buffer*/
+  COUNT_IO(opt,pages_read,1UL);
+  COUNT_IO(opt,cache_misses,1UL);
+  TRACE2(page_read,block,(unsigned int)opt->key);
+  TRACE2(cache_miss,block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+/****************************************************************************
+   read_node: Reads a node like read_block(),serving the root of a
+   B-epsilon tree from memory,where the inserts buffered there may not
+			    have reached its block yet.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's header,the block to read and the node to fill.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_node(options_t *const opt,header_t *const h,
+			  long block,node_t *const node)
+{
+  status_t status;
+
+  if(block==opt->top_block)
+  {
+    memcpy(node,&opt->top,sizeof(node_t));
+    COUNT_IO(opt,cache_hits,1UL);
+    TRACE2(cache_hit,block,(unsigned int)opt->key);
+    return SUCCESS;
+  }
+  if((status=read_block(opt,h,block,node))!=SUCCESS)
+    return status;
+  if(BUFFERED(h)&&block==h->root_block)
+  {
+    opt->top_block=block;
+    memcpy(&opt->top,node,sizeof(node_t));
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   write_block: Overwrites the node stored at a block of the index file.
+      If a live snapshot may still need the old contents of the block,
+	     they are copied to the version store first.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's header,the block to overwrite and the new node.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t save_version(options_t *const opt,header_t *const h,
+			     long block);
+
+static status_t put_block(options_t *const opt,header_t *const h,
+			  long block,const node_t *const node);
+
+static status_t write_block(options_t *const opt,header_t *const h,
+			    long block,const node_t *const node)
+{
+  status_t status;
+
+  if(opt->snapshots!=NULL&&(status=save_version(opt,h,block))!=SUCCESS)
+    return status;
+  return put_block(opt,h,block,node);
+}
+
+/****************************************************************************
+  put_block: Overwrites a block in place,bypassing the version store.  Only
+	   for changes that no snapshot reader can observe.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's header,the block to overwrite and the new node.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t put_block(options_t *const opt,header_t *const h,
+			  long block,const node_t *const node)
+{
+  if(seek_file(opt,block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(node,h->block_size,1,opt->iop)!=1)
+    return E_WRITE_FILE;
+  COUNT_IO(opt,pages_written,1UL);
+  COUNT_IO(opt,bytes_written,(unsigned long)h->block_size);
+  TRACE2(page_write,block,(unsigned int)opt->key);
+  if(block==opt->tail_block)  /*keep the pinned copies current*/
+    memcpy(&opt->tail,node,sizeof(node_t));
+  if(block==opt->top_block)
+  {
+    if(node!=&opt->top)
+      memcpy(&opt->top,node,sizeof(node_t));
+    opt->top_dirty=false;
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   append_block: Writes a node to a new block at the end of the index file.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+  the B+ tree's header,a pointer to receive the new block and the new node.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t append_block(options_t *const opt,header_t *const h,
+			     long *const block,const node_t *const node)
+{
+  if(seek_file(opt,0L,SEEK_END)!=0)
+    return E_MOVE_FILE;
+  if((*block=ftell(opt->iop))==-1L)
+    return E_MOVE_FILE;
+  if(fwrite(node,h->block_size,1,opt->iop)!=1)
+    return E_WRITE_FILE;
+  COUNT_IO(opt,pages_written,1UL);
+  COUNT_IO(opt,bytes_written,(unsigned long)h->block_size);
+  TRACE2(page_write,*block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+/****************************************************************************
+   save_version: Copies the current contents of a block to the version
+    store,unless the newest live snapshot is already covered by an older
+    copy.  The copy is tagged with the epoch of the running update,so it
+	   serves every snapshot taken before that update.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+	the B+ tree's header and the block about to be overwritten.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t save_version(options_t *const opt,header_t *const h,
+			     long block)
+{
+  unsigned long last_end;
+  version_t *v,**bucket;
+  status_t status;
+
+  bucket=&opt->version[(unsigned long)block%VERSION_HASH_SIZE];
+  last_end=0UL;
+  for(v=*bucket;v!=NULL;v=v->next)
+    if(v->block==block&&v->end>last_end)
+      last_end=v->end;
+  if(last_end>opt->snapshots->epoch)  /*the newest snapshot is covered*/
+    return SUCCESS;
+  if(block>=opt->snapshots->end_block)  /*appended after every snapshot*/
+    return SUCCESS;
+  if((v=(version_t *)malloc(sizeof(version_t)))==NULL)
+    return E_NO_MEMORY;
+  if((status=read_block(opt,h,block,&v->node))!=SUCCESS)
+  {
+    free(v);
+    return status;
+  }
+  v->block=block;
+  v->begin=last_end;
+  v->end=opt->epoch+1UL;
+  v->next=*bucket;
+  *bucket=v;
+  return SUCCESS;
+}
+
+/****************************************************************************
+     purge_versions: Frees the before-images no live snapshot can see.
+	   -input: A constant pointer to the B+ tree's options.
+			      -output: None.
+****************************************************************************/
+static void purge_versions(options_t *const opt)
+{
+  version_t *v,**link;
+  snapshot_t *snap;
+  word_t index;
+
+  for(index=0;index<VERSION_HASH_SIZE;++index)
+  {
+    link=&opt->version[index];
+    while((v=*link)!=NULL)
+    {
+      for(snap=opt->snapshots;snap!=NULL;snap=snap->next)
+	if(snap->epoch>=v->begin&&snap->epoch<v->end)
+	  break;
+      if(snap==NULL)  /*the image is invisible to every live snapshot*/
+      {
+	*link=v->next;
+	free(v);
+      }
+      else link=&v->next;
+    }
+  }
+  return;
+}
+
+/****************************************************************************
+	    free_versions: Frees the whole version store.
+	   -input: A constant pointer to the B+ tree's options.
+			      -output: None.
+****************************************************************************/
+static void free_versions(options_t *const opt)
+{
+  version_t *v;
+  word_t index;
+
+  for(index=0;index<VERSION_HASH_SIZE;++index)
+    while((v=opt->version[index])!=NULL)
+    {
+      opt->version[index]=v->next;
+      free(v);
+    }
+  return;
+}
+
+/****************************************************************************
+  open_snapshot: Pins the current version of the B+ tree.  Later updates
+   keep the pinned version readable through the version store until the
+		 snapshot is released by close_snapshot().
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+     the B+ tree's header and a pointer to receive the new snapshot.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t open_snapshot(options_t *const opt,header_t *const h,
+			      snapshot_t **const snap)
+{
+  status_t status;
+
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(h==NULL)
+    return INV_HEADER_PTR;
+  if(snap==NULL)
+    return INV_DATA_PTR;
+  if((status=write_top(opt,h))!=SUCCESS)  /*snapshots read the file*/
+    return status;
+  if(seek_file(opt,0L,SEEK_END)!=0)
+    return E_MOVE_FILE;
+  if((*snap=(snapshot_t *)malloc(sizeof(snapshot_t)))==NULL)
+    return E_NO_MEMORY;
+  (*snap)->epoch=opt->epoch;
+  (*snap)->root_block=h->root_block;
+  (*snap)->end_block=ftell(opt->iop);
+  (*snap)->next=opt->snapshots;
+  opt->snapshots=*snap;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   close_snapshot: Releases a snapshot and reclaims the page versions that
+			  were kept only for it.
+  -input: A constant pointer to the B+ tree's options and the snapshot.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t close_snapshot(options_t *const opt,snapshot_t *const snap)
+{
+  snapshot_t **link;
+
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(snap==NULL)
+    return INV_DATA_PTR;
+  for(link=&opt->snapshots;*link!=NULL;link=&(*link)->next)
+    if(*link==snap)
+    {
+      *link=snap->next;
+      free(snap);
+      purge_versions(opt);
+      break;
+    }
+  return SUCCESS;
+}
+
+/****************************************************************************
+  read_snapshot_block: Reads a block as it was when a snapshot was taken.
+   The oldest image overwritten after the snapshot holds those contents;
+	    without one,the block is unchanged since then.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+     the B+ tree's header,the snapshot,the block and the node to fill.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_snapshot_block(options_t *const opt,header_t *const h,
+				    const snapshot_t *const snap,long block,
+				    node_t *const node)
+{
+  version_t *v,*found;
+
+  found=NULL;
+  for(v=opt->version[(unsigned long)block%VERSION_HASH_SIZE];v!=NULL;
+      v=v->next)
+    if(v->block==block&&v->end>snap->epoch&&(found==NULL||v->end<found->end))
+      found=v;
+  if(found==NULL)
+    return read_block(opt,h,block,node);
+  memcpy(node,&found->node,sizeof(node_t));
+  COUNT_IO(opt,cache_hits,1UL);
+  TRACE2(cache_hit,block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+/****************************************************************************
+   enter_node/leave_node: Keep track of the buffered inserts of a B-epsilon
+   tree while a cursor passes through a node.  On the way in,the inserts
+   below the cursor are skipped;on the way out,the ones not yet returned
+   are merged into the carry,because they may still lie below the next key
+			of an ancestor.
+	  -input: The cursor and the level of the node in it.
+			      -output: None.
+****************************************************************************/
+static void enter_node(cursor_t *const cur,int depth)
+{
+  const node_t *const node=&cur->node[depth];
+  word_t index;
+
+  for(index=0;index<node->msgs_used;++index)
+    if((long)node->msg[index]>=cur->floor)
+      break;
+  cur->msg_pos[depth]=index;
+  return;
+}
+
+static void leave_node(cursor_t *const cur,int depth)
+{
+  const node_t *const node=&cur->node[depth];
+  word_t index;
+  int slot;
+
+  if(cur->carry_next>0)  /*drop the part already returned*/
+  {
+    memmove(cur->carry,cur->carry+cur->carry_next,
+	    (size_t)(cur->carry_used-cur->carry_next)*sizeof(word_t));
+    cur->carry_used-=cur->carry_next;
+    cur->carry_next=0;
+  }
+  for(index=cur->msg_pos[depth];index<node->msgs_used&&
+      cur->carry_used<CARRY_SIZE;++index)
+  {
+    for(slot=cur->carry_used;slot>0&&cur->carry[slot-1]>node->msg[index];
+	--slot)
+      cur->carry[slot]=cur->carry[slot-1];
+    cur->carry[slot]=node->msg[index];
+    ++cur->carry_used;
+  }
+  return;
+}
+
+/****************************************************************************
+    open_cursor: Positions a cursor at the first key of a snapshot that
+		     is greater than or equal to a value.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's header,the snapshot,the lower bound and the cursor.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t open_cursor(options_t *const opt,header_t *const h,
+			    snapshot_t *const snap,word_t low,
+			    cursor_t *const cur)
+{
+  long block;
+  word_t new_pos;
+  status_t status;
+  node_t *node;
+
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(h==NULL)
+    return INV_HEADER_PTR;
+  if(snap==NULL||cur==NULL)
+    return INV_DATA_PTR;
+  cur->snap=snap;
+  cur->depth=-1;
+  cur->floor=(long)low;
+  cur->carry_next=cur->carry_used=0;
+  opt->key=low;
+  for(block=snap->root_block;block!=NO_BLOCK;block=node->block[new_pos])
+  {
+    if(cur->depth+1==MAX_TREE_HEIGHT)
+      return E_TREE_TOO_DEEP;
+    node=&cur->node[++cur->depth];
+    if((status=read_snapshot_block(opt,h,snap,block,node))!=SUCCESS)
+      return status;
+    enter_node(cur,cur->depth);
+    for(new_pos=0;new_pos<node->keys_used;++new_pos)
+      if(low<=node->key[new_pos])
+	break;
+    cur->pos[cur->depth]=new_pos;
+    if(new_pos<node->keys_used&&low==node->key[new_pos])
+      break;  /*the lower bound itself is the first key*/
+  }
+  while(cur->depth>=0&&cur->pos[cur->depth]>=cur->node[cur->depth].keys_used)
+    leave_node(cur,cur->depth--);  /*the rest is below the lower bound*/
+  return SUCCESS;
+}
+
+/****************************************************************************
+    next_cursor: Returns the key under a cursor and moves the cursor to
+   the following key in ascending order.  In a B-epsilon tree the key is
+   the smallest of the next key in the nodes and the next buffered insert
+      of every node on the path or in the carry,returned only once.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the cursor and a pointer to receive the key.
+  -output: A status_t value indicating success,E_END_OF_SCAN or an error.
+****************************************************************************/
+static status_t next_cursor(options_t *const opt,header_t *const h,
+			    cursor_t *const cur,word_t *const value)
+{
+  long block,best;
+  status_t status;
+  node_t *node;
+  int depth;
+
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(h==NULL)
+    return INV_HEADER_PTR;
+  if(cur==NULL||value==NULL)
+    return INV_DATA_PTR;
+  best=WORD_T_MAX+1L;
+  if(cur->depth>=0)
+    best=(long)cur->node[cur->depth].key[cur->pos[cur->depth]];
+  for(depth=0;depth<=cur->depth;++depth)
+    if(cur->msg_pos[depth]<cur->node[depth].msgs_used&&
+       (long)cur->node[depth].msg[cur->msg_pos[depth]]<best)
+      best=(long)cur->node[depth].msg[cur->msg_pos[depth]];
+  if(cur->carry_next<cur->carry_used&&(long)cur->carry[cur->carry_next]<best)
+    best=(long)cur->carry[cur->carry_next];
+  if(best>WORD_T_MAX)
+    return E_END_OF_SCAN;
+  *value=(word_t)best;
+  cur->floor=best+1L;
+  for(depth=0;depth<=cur->depth;++depth)  /*a key is returned only once*/
+    while(cur->msg_pos[depth]<cur->node[depth].msgs_used&&
+	  (long)cur->node[depth].msg[cur->msg_pos[depth]]<cur->floor)
+      ++cur->msg_pos[depth];
+  while(cur->carry_next<cur->carry_used&&
+	(long)cur->carry[cur->carry_next]<cur->floor)
+    ++cur->carry_next;
+  if(cur->depth<0||cur->node[cur->depth].key[cur->pos[cur->depth]]!=*value)
+    return SUCCESS;  /*a buffered insert,the nodes stay where they are*/
+  node=&cur->node[cur->depth];
+  ++cur->pos[cur->depth];
+
+  /*the next key is the leftmost one in the subtree right of this key*/
+  while((block=node->block[cur->pos[cur->depth]])!=NO_BLOCK)
+  {
+    if(cur->depth+1==MAX_TREE_HEIGHT)
+      return E_TREE_TOO_DEEP;
+    node=&cur->node[++cur->depth];
+    if((status=read_snapshot_block(opt,h,cur->snap,block,node))!=SUCCESS)
+      return status;
+    enter_node(cur,cur->depth);
+    cur->pos[cur->depth]=0;
+  }
+  while(cur->depth>=0&&cur->pos[cur->depth]>=cur->node[cur->depth].keys_used)
+    leave_node(cur,cur->depth--);
+  return SUCCESS;
+}
+
+/****************************************************************************
+   scan_tree: Passes the keys of a range from a snapshot of the B+ tree to
+     a function,until the range ends or the function returns nonzero.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the bounds of the range (inclusive),the function
+			 and its argument.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t scan_tree(options_t *const opt,header_t *const h,
+			  word_t low,word_t high,bp_scan_fn fn,void *arg)
+{
+  snapshot_t *snap;
+  status_t status;
+  cursor_t *cur;
+  word_t value;
+
+  if((cur=(cursor_t *)malloc(sizeof(cursor_t)))==NULL)
+    return E_NO_MEMORY;
+  if((status=open_snapshot(opt,h,&snap))!=SUCCESS)
+  {
+    free(cur);
+    return status;
+  }
+  if((status=open_cursor(opt,h,snap,low,cur))==SUCCESS)
+    while((status=next_cursor(opt,h,cur,&value))==SUCCESS&&value<=high)
+      if((*fn)(value,arg)!=0)
+	break;
+  close_snapshot(opt,snap);
+  free(cur);
+  return (status==E_END_OF_SCAN||status==SUCCESS)?SUCCESS:status;
+}
+
+/****************************************************************************
+   rank_value: Counts the keys below a value,or up to it.  A counted tree
+   adds up the counts left of the path to the value;any other tree scans.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the value,true to count the value itself and a
+			  pointer to receive the count.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static int count_key(word_t value,void *arg);
+static word_t find_child(const node_t *const node,word_t value);
+static unsigned long child_keys(const node_t *const node,word_t child);
+
+static status_t rank_value(options_t *const opt,header_t *const h,
+			   word_t value,boolean_t inclusive,
+			   unsigned long *const rank)
+{
+  word_t new_pos,index;
+  status_t status;
+  long block;
+
+  *rank=0UL;
+  if(!COUNTED(h))
+  {
+    if(inclusive==false&&value==0)
+      return SUCCESS;
+    return scan_tree(opt,h,0,(inclusive==true)?value:(word_t)(value-1),
+		     count_key,rank);
+  }
+  opt->key=value;
+  for(block=h->root_block;block!=NO_BLOCK;block=opt->p->block[new_pos])
+  {
+    TRACE2(descend,block,(unsigned int)value);
+    if((status=read_node(opt,h,block,opt->p))!=SUCCESS)
+      return status;
+    new_pos=find_child(opt->p,value);
+    for(index=0;index<new_pos;++index)
+      *rank+=child_keys(opt->p,index)+1UL;
+    if(new_pos<opt->p->keys_used&&value==opt->p->key[new_pos])
+    {
+      *rank+=child_keys(opt->p,new_pos)+((inclusive==true)?1UL:0UL);
+      break;
+    }
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   select_value: Finds the key with a given number of keys below it.  A
+   counted tree follows the counts down;any other tree scans.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the rank and a pointer to receive the key.
+  -output: SUCCESS,E_NOT_FOUND past the last key,E_TREE_EMPTY or an error.
+****************************************************************************/
+typedef struct { unsigned long rank; word_t *value; boolean_t found; } pick_t;
+
+static int pick_key(word_t value,void *arg);
+
+static status_t select_value(options_t *const opt,header_t *const h,
+			     unsigned long rank,word_t *const value)
+{
+  unsigned long below;
+  status_t status;
+  word_t index;
+  pick_t pick;
+  long block;
+
+  if(h->root_block==NO_BLOCK)
+    return E_TREE_EMPTY;
+  if(!COUNTED(h))
+  {
+    pick.rank=rank;
+    pick.value=value;
+    pick.found=false;
+    if((status=scan_tree(opt,h,0,(word_t)WORD_T_MAX,pick_key,&pick))!=SUCCESS)
+      return status;
+    return (pick.found==true)?SUCCESS:E_NOT_FOUND;
+  }
+  for(block=h->root_block;block!=NO_BLOCK;block=opt->p->block[index])
+  {
+    TRACE2(descend,block,(unsigned int)opt->key);
+    if((status=read_node(opt,h,block,opt->p))!=SUCCESS)
+      return status;
+    for(index=0;index<=opt->p->keys_used;++index)
+    {
+      if(rank<(below=child_keys(opt->p,index)))
+	break;  /*the key is under this child*/
+      rank-=below;
+      if(index<opt->p->keys_used)
+      {
+	if(rank==0UL)
+	{
+	  *value=opt->p->key[index];
+	  return SUCCESS;
+	}
+	--rank;
+      }
+    }
+    if(index>opt->p->keys_used)
+      return E_NOT_FOUND;
+  }
+  return E_NOT_FOUND;
+}
+
+/****************************************************************************
+   count_values: Counts the keys of a range as the difference of two ranks
+		  on a counted tree,or by scanning it.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the bounds (inclusive) and a pointer to receive the
+				   count.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t count_values(options_t *const opt,header_t *const h,
+			     word_t low,word_t high,unsigned long *const count)
+{
+  unsigned long below;
+  status_t status;
+
+  *count=0UL;
+  if(low>high)
+    return SUCCESS;
+  if(!COUNTED(h))
+    return scan_tree(opt,h,low,high,count_key,count);
+  if((status=rank_value(opt,h,high,true,count))!=SUCCESS||
+     (status=rank_value(opt,h,low,false,&below))!=SUCCESS)
+    return status;
+  *count-=below;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   count_key/pick_key: The scan_tree() callbacks of the order statistics
+		 on trees without counts.
+   -input: The key and the count to raise,or the pick_t to fill.
+	 -output: Zero to go on,nonzero once the key is picked.
+****************************************************************************/
+static int count_key(word_t value,void *arg)
+{
+  (void)value;
+  ++*(unsigned long *)arg;
+  return 0;
+}
+
+static int pick_key(word_t value,void *arg)
+{
+  pick_t *const pick=(pick_t *)arg;
+
+  if(pick->rank>0UL)
+  {
+    --pick->rank;
+    return 0;
+  }
+  *pick->value=value;
+  pick->found=true;
+  return 1;
+}
+
+/****************************************************************************
+   child_keys/subtree_keys: The keys under a child of a node of a counted
+		  tree,and the keys under a whole node.
+		-input: The node and the index of the child.
+			   -output: The count.
+****************************************************************************/
+static unsigned long child_keys(const node_t *const node,word_t child)
+{
+  return (node->is_leaf==true)?0UL:node->count[child];
+}
+
+static unsigned long subtree_keys(const node_t *const node)
+{
+  unsigned long keys;
+  word_t index;
+
+  keys=(unsigned long)node->keys_used;
+  for(index=0;index<=node->keys_used;++index)
+    keys+=child_keys(node,index);
+  return keys;
+}
+
+/****************************************************************************
+   locate_key: Finds the node that holds a value as a key,leaving the node
+	      in opt->p.  Values still in buffers are not found.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the value and pointers to receive the block of
+			 the node and the key's index.
+   -output: SUCCESS,E_NOT_FOUND,E_TREE_EMPTY or another error.
+****************************************************************************/
+static status_t locate_key(options_t *const opt,header_t *const h,
+			   word_t value,long *const block,word_t *const pos)
+{
+  status_t status;
+
+  if(h->root_block==NO_BLOCK)
+    return E_TREE_EMPTY;
+  opt->key=value;
+  for(*block=h->root_block;*block!=NO_BLOCK;*block=opt->p->block[*pos])
+  {
+    TRACE2(descend,*block,(unsigned int)value);
+    if((status=read_node(opt,h,*block,opt->p))!=SUCCESS)
+      return status;
+    *pos=find_child(opt->p,value);
+    if(*pos<opt->p->keys_used&&value==opt->p->key[*pos])
+      return SUCCESS;
+  }
+  return E_NOT_FOUND;
+}
+
+/****************************************************************************
+	     search_value: Looks a value up in the B+ tree.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+		  the B+ tree's header and the value.
+  -output: SUCCESS if the value is present,E_NOT_FOUND or E_TREE_EMPTY if
+			   not,or another error.
+****************************************************************************/
+static status_t search_value(options_t *const opt,header_t *const h,
+			     word_t value)
+{
+  word_t new_pos,index;
+  status_t status;
+  long block;
+
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(h==NULL)
+    return INV_HEADER_PTR;
+  if(h->root_block==NO_BLOCK)
+    return E_TREE_EMPTY;
+  opt->key=value;
+  for(block=h->root_block;block!=NO_BLOCK;block=opt->p->block[new_pos])
+  {
+    TRACE2(descend,block,(unsigned int)value);
+    if((status=read_node(opt,h,block,opt->p))!=SUCCESS)
+      return status;
+    for(new_pos=0;new_pos<opt->p->keys_used;++new_pos)
+      if(value<=opt->p->key[new_pos])
+	break;
+    if(new_pos<opt->p->keys_used&&value==opt->p->key[new_pos])
+      return SUCCESS;
+    for(index=0;index<opt->p->msgs_used;++index)  /*B-epsilon buffers*/
+      if(opt->p->msg[index]>=value)
+      {
+	if(opt->p->msg[index]==value)
+	  return SUCCESS;
+	break;
+      }
+  }
+  return E_NOT_FOUND;
+}
+
+/****************************************************************************
+		insert_value: Inserts a value in B+ tree.
+   A value above every key skips the descent:the rightmost leaf is pinned
+   in opt->tail from the first descent that ends there,and put_block() and
+		   node_overflow() keep it current.
+ -input: A pointer to the B+ tree's header,a pointer to the B+ tree's options
+	       and a word_t variable (the value to be inserted).
+	   -output: A status_t value indicating sucess or an error.
+	   The caller flushes the index file when it sees fit.
+****************************************************************************/
+static status_t node_overflow(options_t *const opt,header_t *const h,
+			      long block,split_t split);
+
+static boolean_t above_tail(const options_t *const opt,word_t value);
+static status_t place_value(options_t *const opt,header_t *const h,
+			    word_t value);
+static status_t buffer_value(options_t *const opt,header_t *const h,
+			     word_t value);
+
+static status_t insert_value(header_t *h,options_t *opt,word_t value)
+{
+  word_t index;
+  status_t status;
+  long block;
+
+  if(h==NULL)
+    return INV_HEADER_PTR;
+  if(opt==NULL)
+    return INV_OPT_PTR;
+  if(h->tree_order>TREE_ORDER)
+    return E_INCOMPATIBLE_VERSION;
+  opt->key=value;
+  note_compact(opt,&value,1);
+  if(h->root_block==NO_BLOCK)  /*the tree is initially empty*/
+  {
+    /*initialize root node*/
+    opt->p->key[0]=value;
+    opt->p->keys_used=1;
+    opt->p->parent_block=NO_BLOCK;
+    opt->p->is_leaf=true;
+    opt->p->msgs_used=0;
+    for(index=0;index<=h->tree_order;++index)  /*(tree_order+1) blocks*/
+    {
+      opt->p->block[index]=NO_BLOCK;
+      opt->p->count[index]=0UL;
+    }
+    for(index=0;index<h->tree_order;++index)
+      opt->p->ref[index]=NO_BLOCK;
+    if((status=append_block(opt,h,&block,opt->p))!=SUCCESS||
+       (status=flush_file(opt))!=SUCCESS)
+      return status;
+    h->root_block=block;
+    opt->tail_block=block;
+    memcpy(&opt->tail,opt->p,sizeof(node_t));
+    if((status=write_header(opt,h))!=SUCCESS)
+      return status;
+  }
+  else
+  {
+    if(BUFFERED(h)&&above_tail(opt,value)==false)
+      status=buffer_value(opt,h,value);
+    else status=place_value(opt,h,value);
+    if(status!=SUCCESS)
+      return status;
+  }
+  ++opt->epoch;  /*the update is complete and visible to new snapshots*/
+  return SUCCESS;
+}
+
+/****************************************************************************
+  above_tail: Tells if a value is above every key of the tree,as far as the
+		     pinned rightmost leaf knows.
+  -input: A constant pointer to the B+ tree's options and the value.
+	      -output: true if the value can go to opt->tail.
+****************************************************************************/
+static boolean_t above_tail(const options_t *const opt,word_t value)
+{
+  if(opt->tail_block==NO_BLOCK)
+    return false;
+  return (value>opt->tail.key[opt->tail.keys_used-1])?true:false;
+}
+
+/****************************************************************************
+   place_value: Descends to the leaf of a value,past any buffers,and
+	     inserts the value there,splitting what overflows.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+		  the B+ tree's header and the value.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t add_to_leaf(options_t *const opt,header_t *const h,
+			    long block,word_t new_pos,word_t value);
+static status_t push_path(options_t *const opt,header_t *const h,
+			  long block,word_t child);
+static status_t count_path(options_t *const opt,header_t *const h,
+			   word_t added);
+
+static status_t place_value(options_t *const opt,header_t *const h,
+			    word_t value)
+{
+  boolean_t insert,rightmost,pinned;
+  status_t status;
+  word_t new_pos;
+  long block;
+
+  /*a value above every key goes straight to the pinned rightmost leaf,
+    unless the counts on its path have to be raised*/
+  pinned=(COUNTED(h))?false:above_tail(opt,value);
+  block=(pinned==true)?opt->tail_block:h->root_block;
+  rightmost=true;  /*the root is on the rightmost path*/
+  insert=false;
+  opt->depth=0;
+  while(insert==false)
+  {
+    if(pinned==true)
+    {
+      memcpy(opt->p,&opt->tail,sizeof(node_t));
+      COUNT_IO(opt,cache_hits,1UL);
+      TRACE2(cache_hit,block,(unsigned int)value);
+    }
+    else
+    {
+      TRACE2(descend,block,(unsigned int)value);
+      if((status=read_node(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+    }
+    /*search for the first entry q in node that value<=q*/
+    for(new_pos=0;new_pos<opt->p->keys_used;++new_pos)
+      if(value<=opt->p->key[new_pos])
+	break;
+    if(new_pos<opt->p->keys_used)
+      rightmost=false;
+    if(rightmost==true&&opt->p->is_leaf==true&&block!=opt->tail_block)
+    {
+      opt->tail_block=block;  /*pin the leaf the descent ended in*/
+      memcpy(&opt->tail,opt->p,sizeof(node_t));
+    }
+    if(new_pos<opt->p->keys_used&&value==opt->p->key[new_pos])
+      insert=true;  /*value exists*/
+    else if(opt->p->is_leaf==true)  /*no more path to follow*/
+	 {
+	   if((status=count_path(opt,h,1))!=SUCCESS||
+	      (status=add_to_leaf(opt,h,block,new_pos,value))!=SUCCESS)
+	     return status;
+	   insert=true;  /*value successfully inserted into the tree*/
+	 }
+	 else  /*the path continues*/
+	 {
+	   if((status=push_path(opt,h,block,new_pos))!=SUCCESS)
+	     return status;
+	   block=opt->p->block[new_pos];
+	 }
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   add_to_leaf: Inserts a value at its position in the leaf held in opt->p,
+	     writes the leaf and splits it if it overflows.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the block of the leaf,the position and the value.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static void track_run(options_t *const opt,word_t value);
+
+static status_t add_to_leaf(options_t *const opt,header_t *const h,
+			    long block,word_t new_pos,word_t value)
+{
+  unsigned long start;
+  status_t status;
+  split_t split;
+  word_t index;
+
+  ++(opt->p->keys_used);
+  for(index=opt->p->keys_used-1;index>new_pos;--index)
+  {
+    opt->p->key[index]=opt->p->key[index-1];
+    opt->p->ref[index]=opt->p->ref[index-1];
+  }
+  opt->p->key[new_pos]=value;
+  opt->p->ref[new_pos]=NO_BLOCK;
+  for(index=opt->p->keys_used;index>new_pos;--index)
+    opt->p->block[index]=opt->p->block[index-1];
+  opt->p->block[new_pos+1]=NO_BLOCK;
+  if((status=write_block(opt,h,block,opt->p))!=SUCCESS)
+    return status;
+  track_run(opt,value);
+  if(opt->p->keys_used==h->tree_order)
+  {
+    /*a run that reaches the edge of a node keeps filling that edge,so
+      the node it leaves behind is split nearly full*/
+    if(opt->run>=SEQUENTIAL_RUN&&new_pos==opt->p->keys_used-1)
+      split=SPLIT_RIGHT;
+    else if(opt->run<=-SEQUENTIAL_RUN&&new_pos==0)
+	   split=SPLIT_LEFT;
+	 else split=SPLIT_EVEN;
+    start=now_ns();  /*the whole cascade counts as one split*/
+    status=node_overflow(opt,h,block,split);
+    record_latency(opt,BP_LAT_SPLIT,start);
+  }
+  return status;
+}
+
+/****************************************************************************
+   push_path/count_path: Keep the subtree counts of a counted tree.  The
+   descent of an insert notes each internal node it passes and the child
+   it takes;once the leaf is known to gain keys,the count of that child
+   goes up in every noted node,and the nodes are written back.  Other
+			trees note nothing.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,and the block and the child taken of the node in
+		    opt->p,or the number of keys added.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t push_path(options_t *const opt,header_t *const h,
+			  long block,word_t child)
+{
+  if(!COUNTED(h)||opt->p->is_leaf==true)
+    return SUCCESS;
+  if(opt->depth==MAX_TREE_HEIGHT)
+    return E_TREE_TOO_DEEP;
+  opt->path_block[opt->depth]=block;
+  opt->path_pos[opt->depth]=child;
+  memcpy(&opt->path[opt->depth++],opt->p,sizeof(node_t));
+  return SUCCESS;
+}
+
+static status_t count_path(options_t *const opt,header_t *const h,
+			   word_t added)
+{
+  status_t status;
+  int depth;
+
+  for(depth=0;depth<opt->depth;++depth)
+  {
+    opt->path[depth].count[opt->path_pos[depth]]+=(unsigned long)added;
+    if((status=write_block(opt,h,opt->path_block[depth],
+			   &opt->path[depth]))!=SUCCESS)
+      return status;
+  }
+  opt->depth=0;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   track_run: Counts the inserts in a row that went above or below the
+		  previous one,for the split policy.
+  -input: A constant pointer to the B+ tree's options and the value just
+				 inserted.
+			      -output: None.
+****************************************************************************/
+static void track_run(options_t *const opt,word_t value)
+{
+  if(value>opt->last_value)
+    opt->run=(opt->run>0)?opt->run+1:1;
+  else opt->run=(opt->run<0)?opt->run-1:-1;
+  opt->last_value=value;
+  return;
+}
+
+/****************************************************************************
+   find_child/add_message: The child of an internal node a value belongs
+   to (its own key's index if the node holds the value),and the sorted
+	  insertion of a value in a buffer that has room for it.
+  -input: The node and the value.
+  -output: The index of the child,or true if the value was not buffered
+				 already.
+****************************************************************************/
+static word_t find_child(const node_t *const node,word_t value)
+{
+  word_t index;
+
+  for(index=0;index<node->keys_used;++index)
+    if(value<=node->key[index])
+      break;
+  return index;
+}
+
+static boolean_t add_message(node_t *const node,word_t value)
+{
+  word_t index;
+
+  for(index=node->msgs_used;index>0&&node->msg[index-1]>=value;--index)
+    if(node->msg[index-1]==value)
+      return false;
+  memmove(node->msg+index+1,node->msg+index,
+	  (size_t)(node->msgs_used-index)*sizeof(word_t));
+  node->msg[index]=value;
+  ++node->msgs_used;
+  return true;
+}
+
+/****************************************************************************
+   buffer_value: Inserts a value in a B-epsilon tree by buffering it at the
+   root,which is kept in memory and written back only by bp_flush(),
+   bp_close(),a snapshot or a split;while no snapshot is open the insert
+   costs no write.  A full root buffer is first flushed one batch down,
+	       which writes the root back on the way.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+		  the B+ tree's header and the value.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t flush_buffer(options_t *const opt,header_t *const h,
+			     long block);
+
+static status_t buffer_value(options_t *const opt,header_t *const h,
+			     word_t value)
+{
+  status_t status;
+  word_t index;
+
+  if((status=read_node(opt,h,h->root_block,opt->p))!=SUCCESS)
+    return status;
+  if(opt->p->is_leaf==true)  /*a lone leaf has no buffer*/
+    return place_value(opt,h,value);
+  index=find_child(opt->p,value);
+  if(index<opt->p->keys_used&&opt->p->key[index]==value)
+    return SUCCESS;  /*value exists*/
+  while(opt->p->msgs_used==BUFFER_SIZE)
+    if((status=flush_buffer(opt,h,h->root_block))!=SUCCESS||
+       (status=read_node(opt,h,h->root_block,opt->p))!=SUCCESS)
+      return status;
+  if(add_message(opt->p,value)==false)
+    return SUCCESS;  /*value is already on its way down*/
+  if(opt->snapshots!=NULL||opt->top_block!=h->root_block)
+    return write_block(opt,h,h->root_block,opt->p);
+  memcpy(&opt->top,opt->p,sizeof(node_t));
+  opt->top_dirty=true;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   write_top: Writes the root buffer of a B-epsilon tree back to its block
+		     if it holds inserts the block lacks.
+  -input: A constant pointer to the B+ tree's options and a constant
+			pointer to the B+ tree's header.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t write_top(options_t *const opt,header_t *const h)
+{
+  if(opt->top_dirty==false)
+    return SUCCESS;
+  return write_block(opt,h,opt->top_block,&opt->top);
+}
+
+/****************************************************************************
+   flush_buffer: Moves the buffered inserts of the child with the most of
+   them out of an internal node.  An internal child takes them into its
+   own buffer,after making room the same way;a leaf child gets them
+   inserted one by one.  Inserts of a value the node holds as a key are
+			    dropped on the way.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+	the B+ tree's header and the block of the internal node.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t flush_buffer(options_t *const opt,header_t *const h,
+			     long block)
+{
+  word_t count[TREE_ORDER+1],batch[BUFFER_SIZE];
+  word_t index,child,used,moved,which;
+  status_t status;
+  node_t node,son;
+
+  for(;;)
+  {
+    if((status=read_node(opt,h,block,&node))!=SUCCESS)
+      return status;
+    if(node.msgs_used==0)
+      return SUCCESS;
+
+    /*pick the child with the most buffered inserts*/
+    memset(count,0,sizeof(count));
+    for(index=0;index<node.msgs_used;++index)
+      ++count[find_child(&node,node.msg[index])];
+    for(child=0,index=1;index<=node.keys_used;++index)
+      if(count[index]>count[child])
+	child=index;
+    if((status=read_block(opt,h,node.block[child],&son))!=SUCCESS)
+      return status;
+    if(son.is_leaf==false&&son.msgs_used+count[child]>BUFFER_SIZE)
+    {
+      if((status=flush_buffer(opt,h,node.block[child]))!=SUCCESS)
+	return status;
+      continue;  /*the flush below may have reshaped this node*/
+    }
+
+    /*take the batch out of the buffer*/
+    for(index=used=moved=0;index<node.msgs_used;++index)
+    {
+      which=find_child(&node,node.msg[index]);
+      if(which<node.keys_used&&node.key[which]==node.msg[index])
+	continue;  /*value exists*/
+      if(which==child)
+	batch[moved++]=node.msg[index];
+      else node.msg[used++]=node.msg[index];
+    }
+    node.msgs_used=used;
+    if((status=write_block(opt,h,block,&node))!=SUCCESS)
+      return status;
+    if(son.is_leaf==false)
+    {
+      for(index=0;index<moved;++index)
+      {
+	which=find_child(&son,batch[index]);
+	if(which==son.keys_used||son.key[which]!=batch[index])
+	  add_message(&son,batch[index]);
+      }
+      return write_block(opt,h,node.block[child],&son);
+    }
+    for(index=0;index<moved;++index)
+      if((status=place_value(opt,h,batch[index]))!=SUCCESS)
+	return status;
+    return SUCCESS;
+  }
+}
+
+/****************************************************************************
+   merge_values: Merges ascending values into the tree in one pass.  A
+   descent finds the leaf of the next value,the values that belong to that
+   leaf go into it while it has room,and the leaf is written once;a value
+	   that finds its leaf full is added alone,splitting it.  A B-epsilon
+		 tree buffers the values one by one instead.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the values in ascending order without duplicates
+			       and their number.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t merge_values(options_t *const opt,header_t *const h,
+			     const word_t *const values,size_t count)
+{
+  word_t index,new_pos,added;
+  boolean_t found;
+  status_t status;
+  long block,high;
+  size_t next;
+
+  note_compact(opt,values,count);
+  for(next=0;next<count;)
+  {
+    if(h->root_block==NO_BLOCK||BUFFERED(h))
+    {
+      if((status=insert_value(h,opt,values[next++]))!=SUCCESS)
+	return status;
+      continue;
+    }
+
+    /*descend to the leaf of the next value,noting where its range ends*/
+    opt->key=values[next];
+    high=WORD_T_MAX+1L;
+    found=false;
+    opt->depth=0;
+    for(block=h->root_block;found==false;block=opt->p->block[new_pos])
+    {
+      TRACE2(descend,block,(unsigned int)values[next]);
+      if((status=read_node(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+      new_pos=find_child(opt->p,values[next]);
+      if(new_pos<opt->p->keys_used)
+      {
+	if(opt->p->key[new_pos]==values[next])
+	  found=true;  /*value exists*/
+	else high=(long)opt->p->key[new_pos];
+      }
+      if(opt->p->is_leaf==true)
+	break;
+      if(found==false&&(status=push_path(opt,h,block,new_pos))!=SUCCESS)
+	return status;
+    }
+    if(found==true)
+    {
+      ++next;
+      continue;
+    }
+
+    /*fill the leaf with the values of its range*/
+    for(added=0;next<count&&(long)values[next]<high&&
+	opt->p->keys_used+1<h->tree_order;++next)
+    {
+      new_pos=find_child(opt->p,values[next]);
+      ++(opt->p->keys_used);
+      for(index=opt->p->keys_used-1;index>new_pos;--index)
+      {
+	opt->p->key[index]=opt->p->key[index-1];
+	opt->p->ref[index]=opt->p->ref[index-1];
+      }
+      opt->p->key[new_pos]=values[next];
+      opt->p->ref[new_pos]=NO_BLOCK;
+      opt->p->block[opt->p->keys_used]=NO_BLOCK;
+      track_run(opt,values[next]);
+      ++added;
+    }
+    if(added>0)
+    {
+      if((status=count_path(opt,h,added))!=SUCCESS||
+	 (status=write_block(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+      ++opt->epoch;
+    }
+    else  /*the leaf is full*/
+    {
+      opt->key=values[next];
+      new_pos=find_child(opt->p,values[next]);
+      if((status=count_path(opt,h,1))!=SUCCESS||
+	 (status=add_to_leaf(opt,h,block,new_pos,values[next++]))!=SUCCESS)
+	return status;
+      ++opt->epoch;
+    }
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   drain_memtable: Merges the memtable into the index file and empties it.
+   -input: A constant pointer to the B+ tree's options and a constant
+			pointer to the B+ tree's header.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t drain_memtable(options_t *const opt,header_t *const h)
+{
+  status_t status;
+  bp_op_t op;
+
+  if(opt->mem_used==0)
+    return SUCCESS;
+  op=opt->op;
+  opt->op=BP_OP_INSERT;  /*the I/O belongs to the inserts held*/
+  if((status=merge_values(opt,h,opt->memtable,opt->mem_used))==SUCCESS)
+  {
+    opt->mem_used=0;
+    status=flush_file(opt);
+  }
+  opt->op=op;
+  return status;
+}
+
+/****************************************************************************
+   append_posting: Adds an id to a posting list,starting the list if there
+   is none.  The id goes to the free room of the last extent,or to a new
+   extent twice its size at the end of the index file,linked behind it.
+   -input: A constant pointer to the B+ tree's options,a pointer to the
+   first extent of the list (NO_BLOCK for none,then set) and the id.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_extent(options_t *const opt,long block,
+			    posting_t *const ext,byte_t *const bytes);
+static status_t write_extent(options_t *const opt,long block,
+			     const posting_t *const ext,
+			     const byte_t *const bytes,size_t count);
+
+static status_t append_posting(options_t *const opt,long *const head,
+			       unsigned long id)
+{
+  byte_t bytes[2*sizeof(unsigned long)];
+  posting_t first,last,ext;
+  unsigned long zigzag;
+  status_t status;
+  size_t count;
+  long block;
+
+  first.last=0UL;
+  if(*head!=NO_BLOCK&&(status=read_extent(opt,*head,&first,NULL))!=SUCCESS)
+    return status;
+  zigzag=(id>=first.last)?(id-first.last)<<1:((first.last-id)<<1)-1UL;
+  for(count=0;zigzag>=0x80UL;zigzag>>=7)
+    bytes[count++]=(byte_t)((zigzag&0x7FUL)|0x80UL);
+  bytes[count++]=(byte_t)zigzag;
+
+  if(*head!=NO_BLOCK)
+  {
+    if(first.tail==*head)
+      memcpy(&last,&first,sizeof(posting_t));
+    else if((status=read_extent(opt,first.tail,&last,NULL))!=SUCCESS)
+	   return status;
+    if(last.used+count<=last.size)  /*the last extent has room*/
+    {
+      last.used+=count;
+      if(first.tail==*head)  /*a list of one extent takes one write*/
+      {
+	last.last=id;
+	++last.ids;
+	return write_extent(opt,*head,&last,bytes,count);
+      }
+      if((status=write_extent(opt,first.tail,&last,bytes,count))!=SUCCESS)
+	return status;
+      first.last=id;
+      ++first.ids;
+      return write_extent(opt,*head,&first,NULL,0);
+    }
+  }
+
+  /*a new extent at the end of the file*/
+  ext.tag=POSTING_TAG;
+  ext.next=NO_BLOCK;
+  ext.size=(*head==NO_BLOCK)?POSTING_FIRST:
+	   (last.size<POSTING_LARGEST/2L)?last.size*2UL:POSTING_LARGEST;
+  ext.used=count;
+  ext.last=id;
+  ext.ids=1UL;
+  if(seek_file(opt,0L,SEEK_END)!=0||(block=ftell(opt->iop))==-1L)
+    return E_MOVE_FILE;
+  ext.tail=block;
+  if((status=write_extent(opt,block,&ext,bytes,count))!=SUCCESS)
+    return status;
+  if(seek_file(opt,block+(long)(sizeof(posting_t)+ext.size)-1L,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(putc(0,opt->iop)==EOF)  /*claim the rest of the extent*/
+    return E_WRITE_FILE;
+  if(*head==NO_BLOCK)
+  {
+    *head=block;
+    return SUCCESS;
+  }
+  last.next=block;
+  if(first.tail==*head)
+    first.next=block;
+  else if((status=write_extent(opt,first.tail,&last,NULL,0))!=SUCCESS)
+	 return status;
+  first.tail=block;
+  first.last=id;
+  ++first.ids;
+  return write_extent(opt,*head,&first,NULL,0);
+}
+
+/****************************************************************************
+   walk_postings: Calls a function for every id of a posting list,reading
+		       each extent in one piece.
+   -input: A constant pointer to the B+ tree's options,the first extent of
+	 the list (or NO_BLOCK),the function and its argument.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t walk_postings(options_t *const opt,long head,
+			      bp_posting_fn fn,void *arg)
+{
+  unsigned long id,zigzag;
+  status_t status;
+  posting_t ext;
+  byte_t *bytes;
+  size_t index;
+  int shift;
+
+  if(head==NO_BLOCK)
+    return SUCCESS;
+  if((bytes=(byte_t *)malloc((size_t)POSTING_LARGEST))==NULL)
+    return E_NO_MEMORY;
+  id=0UL;
+  status=SUCCESS;
+  for(;head!=NO_BLOCK&&status==SUCCESS;head=ext.next)
+  {
+    if((status=read_extent(opt,head,&ext,bytes))!=SUCCESS)
+      break;
+    for(index=0;index<ext.used;)
+    {
+      zigzag=0UL;
+      shift=0;
+      do
+      {
+	zigzag|=(unsigned long)(bytes[index]&0x7FU)<<shift;
+	shift+=7;
+      }
+      while((bytes[index++]&0x80U)!=0&&index<ext.used);
+      id=((zigzag&1UL)!=0)?id-((zigzag+1UL)>>1):id+(zigzag>>1);
+      if((*fn)(id,arg)!=0)
+      {
+	ext.next=NO_BLOCK;  /*the caller has seen enough*/
+	break;
+      }
+    }
+  }
+  free(bytes);
+  return status;
+}
+
+/****************************************************************************
+   read_extent/write_extent: Read the head of a posting extent,with its ids
+   if asked,and write the head,with new ids at the end of the used bytes
+		       if there are any.
+   -input: A constant pointer to the B+ tree's options,the block of the
+   extent,its head and a buffer for its ids,or the ids and their number
+			   (already in ext->used).
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_extent(options_t *const opt,long block,
+			    posting_t *const ext,byte_t *const bytes)
+{
+  if(seek_file(opt,block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fread(ext,sizeof(posting_t),1,opt->iop)!=1||ext->tag!=POSTING_TAG||
+     ext->used>ext->size||ext->size>(unsigned long)POSTING_LARGEST)
+    return E_READ_FILE;
+  if(bytes!=NULL&&ext->used>0&&fread(bytes,ext->used,1,opt->iop)!=1)
+    return E_READ_FILE;
+  COUNT_IO(opt,pages_read,1UL);
+  COUNT_IO(opt,cache_misses,1UL);
+  TRACE2(page_read,block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+static status_t write_extent(options_t *const opt,long block,
+			     const posting_t *const ext,
+			     const byte_t *const bytes,size_t count)
+{
+  if(seek_file(opt,block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(ext,sizeof(posting_t),1,opt->iop)!=1)
+    return E_WRITE_FILE;
+  if(count>0)
+  {
+    if(seek_file(opt,block+(long)(sizeof(posting_t)+ext->used-count),
+		 SEEK_SET)!=0)
+      return E_MOVE_FILE;
+    if(fwrite(bytes,count,1,opt->iop)!=1)
+      return E_WRITE_FILE;
+  }
+  COUNT_IO(opt,pages_written,1UL);
+  COUNT_IO(opt,bytes_written,(unsigned long)(sizeof(posting_t)+count));
+  TRACE2(page_write,block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+/****************************************************************************
+    adopt_children: Points the parent_block of every child of a node to
+			     the node's block.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+      the B+ tree's header,the node and the block where it is stored.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t adopt_children(options_t *const opt,header_t *const h,
+			       const node_t *const node,long block)
+{
+  status_t status;
+  node_t child;
+  word_t index;
+
+  if(node->is_leaf==true)
+    return SUCCESS;
+  for(index=0;index<=node->keys_used;++index)
+  {
+    if((status=read_block(opt,h,node->block[index],&child))!=SUCCESS)
+      return status;
+    child.parent_block=block;  /*cursors never follow parent_block*/
+    if((status=put_block(opt,h,node->block[index],&child))!=SUCCESS)
+      return status;
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+	   node_overflow: Implements the overflow in a B+ tree.
+   An even split picks one of the two middle keys at random.  Under a run
+   of ascending inserts,SPLIT_RIGHT moves only 1/SPLIT_SHARE of the keys
+   (at least one) to the new right node,since the left one will not grow
+   again;SPLIT_LEFT does the same for a descending run.  Every level of the
+		      cascade is split the same way.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's file header,the block of the overflowing node,which is
+			held in opt->p,and the split policy.
+       -output: A status_t value indicating success or an error
+****************************************************************************/
+static status_t node_overflow(options_t *const opt,header_t *const h,
+			      long block,split_t split)
+{
+  word_t q,left_keys,right_keys,index,new_pos,middle_key,level;
+  unsigned long left_count,right_count;
+  long left_block,right_block,middle_ref;
+  static boolean_t initialized=false;
+  boolean_t overflow;
+  status_t status;
+  node_t right;
+
+  if(initialized==false)
+  {
+    srand((unsigned int)(time(NULL)%RAND_MAX));
+    initialized=true;
+  }
+  q=(h->tree_order-1)/SPLIT_SHARE;  /*the share of the node's tail*/
+  if(q==0)
+    q=1;
+  switch(split)
+  {
+    case SPLIT_RIGHT:
+      left_keys=h->tree_order-1-q;
+      right_keys=q;
+      break;
+    case SPLIT_LEFT:
+      left_keys=q;
+      right_keys=h->tree_order-1-q;
+      break;
+    default:
+      q=(rand()>(RAND_MAX>>1U))?(word_t)0:(word_t)1;
+      left_keys=(h->tree_order>>1U)-q;
+      right_keys=(h->tree_order>>1U)+q-1;
+      break;
+  }
+  overflow=true;
+  for(level=0;overflow==true;++level)
+  {
+    ++opt->stats.splits[(level<BP_SPLIT_LEVELS)?level:BP_SPLIT_LEVELS-1];
+    TRACE3(split_start,block,(unsigned int)opt->key,(unsigned int)level);
+
+    /*the keys above the middle one move to a new right sibling*/
+    memset(&right,0,sizeof(node_t));
+    middle_key=opt->p->key[left_keys];
+    middle_ref=opt->p->ref[left_keys];
+    right.is_leaf=opt->p->is_leaf;
+    right.keys_used=right_keys;
+    for(index=left_keys+1;index<h->tree_order;++index)
+    {
+      right.key[index-left_keys-1]=opt->p->key[index];
+      right.ref[index-left_keys-1]=opt->p->ref[index];
+    }
+    for(index=left_keys+1;index<=h->tree_order;++index)
+    {
+      right.block[index-left_keys-1]=opt->p->block[index];
+      right.count[index-left_keys-1]=opt->p->count[index];
+    }
+    for(index=right_keys+1;index<=h->tree_order;++index)
+      right.block[index]=NO_BLOCK;
+    opt->p->keys_used=left_keys;
+    for(index=left_keys+1;index<=h->tree_order;++index)
+    {
+      opt->p->block[index]=NO_BLOCK;
+      opt->p->count[index]=0UL;
+    }
+    left_count=right_count=0UL;
+    if(COUNTED(h))  /*what the parent keeps for each half*/
+    {
+      left_count=subtree_keys(opt->p);
+      right_count=subtree_keys(&right);
+    }
+
+    /*buffered inserts follow their keys,the middle one exists already*/
+    for(index=new_pos=0;index<opt->p->msgs_used;++index)
+      if(opt->p->msg[index]<middle_key)
+	opt->p->msg[new_pos++]=opt->p->msg[index];
+      else if(opt->p->msg[index]>middle_key)
+	     right.msg[right.msgs_used++]=opt->p->msg[index];
+    opt->p->msgs_used=new_pos;
+
+    if(opt->p->parent_block==NO_BLOCK)  /*if the root must break*/
+    {
+      TRACE3(root_split,block,(unsigned int)opt->key,(unsigned int)level);
+      /*the root keeps its block,so both sons move to new blocks*/
+      opt->p->parent_block=right.parent_block=block;
+      if((status=append_block(opt,h,&left_block,opt->p))!=SUCCESS||
+	 (status=adopt_children(opt,h,opt->p,left_block))!=SUCCESS)
+	return status;
+      if((status=append_block(opt,h,&right_block,&right))!=SUCCESS||
+	 (status=adopt_children(opt,h,&right,right_block))!=SUCCESS)
+	return status;
+      if(block==opt->tail_block)  /*the root was the only leaf*/
+      {
+	opt->tail_block=right_block;
+	memcpy(&opt->tail,&right,sizeof(node_t));
+      }
+
+      /*rewrite the root node*/
+      opt->p->is_leaf=false;
+      opt->p->keys_used=1,opt->p->parent_block=NO_BLOCK;
+      opt->p->msgs_used=0;
+      opt->p->key[0]=middle_key;
+      opt->p->ref[0]=middle_ref;
+      opt->p->block[0]=left_block,opt->p->block[1]=right_block;
+      opt->p->count[0]=left_count,opt->p->count[1]=right_count;
+      if((status=write_block(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+      TRACE3(split_done,block,(unsigned int)opt->key,(unsigned int)level);
+
+      overflow=false; /*the root has been broken*/
+    }
+    else
+    {
+      right.parent_block=opt->p->parent_block;
+      if((status=write_block(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+      if((status=append_block(opt,h,&right_block,&right))!=SUCCESS||
+	 (status=adopt_children(opt,h,&right,right_block))!=SUCCESS)
+	return status;
+      if(block==opt->tail_block)  /*the right half is the new tail*/
+      {
+	opt->tail_block=right_block;
+	memcpy(&opt->tail,&right,sizeof(node_t));
+      }
+      TRACE3(split_done,block,(unsigned int)opt->key,(unsigned int)level);
+
+      /*the middle key moves up into the parent*/
+      block=opt->p->parent_block;
+      if((status=read_node(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+      for(new_pos=0;new_pos<opt->p->keys_used;++new_pos)
+	if(middle_key<opt->p->key[new_pos])
+	  break;
+      ++(opt->p->keys_used);
+      for(index=opt->p->keys_used-1;index>new_pos;--index)
+      {
+	opt->p->key[index]=opt->p->key[index-1];
+	opt->p->ref[index]=opt->p->ref[index-1];
+      }
+      opt->p->key[new_pos]=middle_key;
+      opt->p->ref[new_pos]=middle_ref;
+      for(index=opt->p->keys_used;index>new_pos+1;--index)
+      {
+	opt->p->block[index]=opt->p->block[index-1];
+	opt->p->count[index]=opt->p->count[index-1];
+      }
+      opt->p->block[new_pos+1]=right_block;
+      opt->p->count[new_pos]=left_count,opt->p->count[new_pos+1]=right_count;
+      for(index=0;index<opt->p->msgs_used;++index)
+	if(opt->p->msg[index]==middle_key)  /*now a key of its own*/
+	{
+	  memmove(opt->p->msg+index,opt->p->msg+index+1,
+		  (size_t)(opt->p->msgs_used-index-1)*sizeof(word_t));
+	  --opt->p->msgs_used;
+	  break;
+	}
+      if((status=write_block(opt,h,block,opt->p))!=SUCCESS)
+	return status;
+      if(opt->p->keys_used<h->tree_order)
+	overflow=false;
+    }
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   read_page/write_page/append_page: The block I/O of string trees,whose
+			pages bypass the version store.
+  -input: A constant pointer to the B+ tree's options,the block (or a
+	 pointer to receive a new one) and the page.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_page(options_t *const opt,long block,byte_t *const page)
+{
+  if(seek_file(opt,block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fread(page,STRING_PAGE_SIZE,1,opt->iop)!=1)
+    return E_READ_FILE;
+  COUNT_IO(opt,pages_read,1UL);
+  COUNT_IO(opt,cache_misses,1UL);
+  TRACE2(page_read,block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+static status_t write_page(options_t *const opt,long block,
+			   const byte_t *const page)
+{
+  if(seek_file(opt,block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(page,STRING_PAGE_SIZE,1,opt->iop)!=1)
+    return E_WRITE_FILE;
+  COUNT_IO(opt,pages_written,1UL);
+  COUNT_IO(opt,bytes_written,(unsigned long)STRING_PAGE_SIZE);
+  TRACE2(page_write,block,(unsigned int)opt->key);
+  return SUCCESS;
+}
+
+static status_t append_page(options_t *const opt,long *const block,
+			    const byte_t *const page)
+{
+  if(seek_file(opt,0L,SEEK_END)!=0||(*block=ftell(opt->iop))==-1L)
+    return E_MOVE_FILE;
+  return write_page(opt,*block,page);
+}
+
+/****************************************************************************
+   compare_strings/compare_slot: memcmp() order of two keys,shorter first on
+   a tie,and of the key in a slot of a page against another key.
+   -input: The two keys and their lengths,or the page,the slot and the key.
+	       -output: <0,0 or >0,like memcmp().
+****************************************************************************/
+static int compare_strings(const byte_t *const a,size_t a_length,
+			   const byte_t *const b,size_t b_length)
+{
+  int result;
+
+  result=memcmp(a,b,(a_length<b_length)?a_length:b_length);
+  if(result!=0)
+    return result;
+  return (a_length<b_length)?-1:(a_length>b_length)?1:0;
+}
+
+static int compare_slot(const byte_t *const page,word_t index,
+			const byte_t *const key,size_t length)
+{
+  const page_t *const head=(const page_t *)page;
+  const slot_t *const slot=(const slot_t *)(page+sizeof(page_t))+index;
+  int result;
+
+  if(length<head->prefix)  /*the key ends inside the shared prefix*/
+  {
+    result=memcmp(page+STRING_PAGE_SIZE-head->prefix,key,length);
+    return (result!=0)?result:1;
+  }
+  if((result=memcmp(page+STRING_PAGE_SIZE-head->prefix,key,
+		    head->prefix))!=0)
+    return result;
+  return compare_strings(page+slot->offset,slot->length,key+head->prefix,
+			 length-head->prefix);
+}
+
+/****************************************************************************
+   search_page: Binary search of a key in the slots of a page.
+   -input: The page,the key,its length and a pointer to receive if the key
+			      is in the page.
+	   -output: The first slot whose key is not below the key.
+****************************************************************************/
+static word_t search_page(const byte_t *const page,const byte_t *const key,
+			  size_t length,boolean_t *const found)
+{
+  word_t low,high,middle;
+  int result;
+
+  low=0;
+  high=((const page_t *)page)->slots;
+  *found=false;
+  while(low<high)
+  {
+    middle=low+(high-low)/2;
+    if((result=compare_slot(page,middle,key,length))<0)
+      low=middle+1;
+    else
+    {
+      if(result==0)
+	*found=true;
+      high=middle;
+    }
+  }
+  return low;
+}
+
+/****************************************************************************
+   child_page: The child of an internal page whose range holds a key:the
+	      child right of the last separator not above it.
+		     -input: The page and the key.
+			 -output: The child.
+****************************************************************************/
+static long child_page(const byte_t *const page,const byte_t *const key,
+		       size_t length)
+{
+  boolean_t found;
+  word_t index;
+
+  index=search_page(page,key,length,&found);
+  if(found==true)
+    ++index;  /*a separator equal to the key starts the right child*/
+  if(index==0)
+    return ((const page_t *)page)->first;
+  return ((const slot_t *)(page+sizeof(page_t)))[index-1].child;
+}
+
+/****************************************************************************
+   decode_page/encode_page: Expand the keys of a page in full,and lay keys
+   out in a page again,with the prefix they share stored once and no gaps.
+   -input: The page and the entries to fill or store,with their number,
+		 whether the page is a leaf and its first block.
+   -output: The number of keys,or false if the keys do not fit the page.
+****************************************************************************/
+static word_t decode_page(const byte_t *const page,entry_t *const entry)
+{
+  const page_t *const head=(const page_t *)page;
+  const slot_t *const slot=(const slot_t *)(page+sizeof(page_t));
+  word_t index;
+
+  for(index=0;index<head->slots;++index)
+  {
+    memcpy(entry[index].key,page+STRING_PAGE_SIZE-head->prefix,head->prefix);
+    memcpy(entry[index].key+head->prefix,page+slot[index].offset,
+	   slot[index].length);
+    entry[index].length=head->prefix+slot[index].length;
+    memcpy(entry[index].value,page+slot[index].offset+slot[index].length,
+	   slot[index].value);
+    entry[index].value_length=slot[index].value;
+    entry[index].logged=(slot[index].logged!=0)?true:false;
+    entry[index].child=slot[index].child;
+  }
+  return head->slots;
+}
+
+static size_t common_prefix(const entry_t *const a,const entry_t *const b);
+static size_t page_bytes(const entry_t *const entry,word_t count);
+
+static boolean_t encode_page(byte_t *const page,const entry_t *const entry,
+			     word_t count,boolean_t is_leaf,long first)
+{
+  page_t *const head=(page_t *)page;
+  slot_t *const slot=(slot_t *)(page+sizeof(page_t));
+  word_t index;
+  size_t prefix;
+
+  if(page_bytes(entry,count)>STRING_PAGE_SIZE)
+    return false;
+  prefix=(count>1)?common_prefix(&entry[0],&entry[count-1]):0;
+  head->is_leaf=is_leaf;
+  head->slots=count;
+  head->prefix=(word_t)prefix;
+  head->first=first;
+  head->heap=(word_t)(STRING_PAGE_SIZE-prefix);
+  if(prefix>0)
+    memcpy(page+head->heap,entry[0].key,prefix);
+  for(index=0;index<count;++index)
+  {
+    slot[index].length=(word_t)(entry[index].length-prefix);
+    slot[index].value=(word_t)entry[index].value_length;
+    slot[index].logged=(entry[index].logged==true)?1:0;
+    head->heap-=slot[index].length+slot[index].value;
+    slot[index].offset=head->heap;
+    slot[index].child=entry[index].child;
+    memcpy(page+head->heap,entry[index].key+prefix,slot[index].length);
+    memcpy(page+head->heap+slot[index].length,entry[index].value,
+	   slot[index].value);
+  }
+  return true;
+}
+
+/****************************************************************************
+   common_prefix: The number of leading bytes two keys share.
+			-input: The two keys.
+			   -output: The count.
+****************************************************************************/
+static size_t common_prefix(const entry_t *const a,const entry_t *const b)
+{
+  size_t index,length;
+
+  length=(a->length<b->length)?a->length:b->length;
+  for(index=0;index<length&&a->key[index]==b->key[index];++index)
+    ;
+  return index;
+}
+
+/****************************************************************************
+   page_bytes: The bytes a page of some keys and values takes,with the
+   prefix the keys share stored once;sorted keys share what the ends do.
+		   -input: The entries and their number.
+			  -output: The bytes.
+****************************************************************************/
+static size_t page_bytes(const entry_t *const entry,word_t count)
+{
+  size_t prefix,bytes;
+  word_t index;
+
+  prefix=(count>1)?common_prefix(&entry[0],&entry[count-1]):0;
+  bytes=sizeof(page_t)+count*sizeof(slot_t)+prefix;
+  for(index=0;index<count;++index)
+    bytes+=entry[index].length-prefix+entry[index].value_length;
+  return bytes;
+}
+
+/****************************************************************************
+   split_string: Picks where a full page splits.  The page splits where its
+   bytes do,for keys differ in length;a leaf then moves the split up to an
+   eighth of its keys away,where the separator,the shortest head of the
+   right half's first key above the left half's last key,is shortest and
+   both halves still fit.  An internal page's middle key moves up.
+   -input: The entries of the page,their number and whether it is a leaf.
+   -output: The first entry of the right half,or the one that moves up.
+****************************************************************************/
+static word_t split_string(const entry_t *const entry,word_t count,
+			   boolean_t is_leaf)
+{
+  size_t half,bytes,prefix;
+  word_t index,best,low,high;
+
+  prefix=common_prefix(&entry[0],&entry[count-1]);
+  for(half=0,index=0;index<count;++index)
+    half+=sizeof(slot_t)+entry[index].length-prefix+
+      entry[index].value_length;
+  half/=2;
+  for(bytes=0,best=0;best<count-1;++best)
+    if((bytes+=sizeof(slot_t)+entry[best].length-prefix+
+	entry[best].value_length)>=half)
+      break;
+  if(best==0)
+    best=1;
+  if(is_leaf==false)
+    return (best>count-2)?count-2:best;
+  low=(best>count/8+1)?best-count/8:1;
+  high=(best+count/8<count-1)?best+count/8:count-1;
+  for(index=low;index<=high;++index)
+    if(common_prefix(&entry[index-1],&entry[index])<
+       common_prefix(&entry[best-1],&entry[best])&&
+       page_bytes(entry,index)<=STRING_PAGE_SIZE&&
+       page_bytes(entry+index,count-index)<=STRING_PAGE_SIZE)
+      best=index;
+  return best;
+}
+
+/****************************************************************************
+   insert_string: Inserts a key and its value in a string tree,or replaces
+   the value of a key that is there.  The descent notes its path,since
+   pages keep no parent block;a page that overflows splits in two and sends
+   a separator to the page above,and the root keeps its block by moving
+			 both halves to new blocks.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+     the B+ tree's header,the key with its value and whether to replace it.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t insert_string(options_t *const opt,header_t *const h,
+			      const entry_t *const item,boolean_t replace)
+{
+  const byte_t *const key=item->key;
+  const size_t length=item->length;
+  page_t *const head=(page_t *)opt->page;
+  long path[MAX_TREE_HEIGHT],block,left_block,right_block,first;
+  word_t count,middle,pos;
+  boolean_t found,is_leaf;
+  entry_t *const entry=opt->entry;
+  status_t status;
+  entry_t up;
+  int depth;
+
+  opt->key=(length>0)?key[0]:0;
+  if(h->root_block==NO_BLOCK)  /*the tree is initially empty*/
+  {
+    encode_page(opt->page,item,1,true,NO_BLOCK);
+    if((status=append_page(opt,&block,opt->page))!=SUCCESS)
+      return status;
+    h->root_block=block;
+    return write_header(opt,h);
+  }
+
+  /*descend to the leaf of the key*/
+  for(depth=0,block=h->root_block;;block=child_page(opt->page,key,length))
+  {
+    if(depth==MAX_TREE_HEIGHT)
+      return E_TREE_TOO_DEEP;
+    TRACE2(descend,block,(unsigned int)opt->key);
+    if((status=read_page(opt,block,opt->page))!=SUCCESS)
+      return status;
+    path[depth++]=block;
+    if(head->is_leaf==true)
+      break;
+  }
+  pos=search_page(opt->page,key,length,&found);
+  if(found==true&&replace==false)
+    return SUCCESS;  /*key exists*/
+  memcpy(&up,item,sizeof(entry_t));
+
+  /*put the key (later a separator) in the page,splitting what overflows*/
+  for(is_leaf=true;;is_leaf=false,found=false)
+  {
+    count=decode_page(opt->page,entry);
+    first=head->first;
+    if(is_leaf==false)
+      pos=search_page(opt->page,up.key,up.length,&found);
+    if(found==false)
+    {
+      memmove(entry+pos+1,entry+pos,(count-pos)*sizeof(entry_t));
+      ++count;
+    }
+    memcpy(&entry[pos],&up,sizeof(entry_t));
+    block=path[--depth];
+    if(encode_page(opt->page,entry,count,is_leaf,first)==true)
+      return write_page(opt,block,opt->page);
+
+    ++opt->stats.splits[(is_leaf==true)?0:1];
+    TRACE3(split_start,block,(unsigned int)opt->key,0U);
+    middle=split_string(entry,count,is_leaf);
+    if(is_leaf==true)  /*the shortest separator that tells the halves apart*/
+    {
+      up.length=common_prefix(&entry[middle-1],&entry[middle])+1;
+      up.value_length=0;
+      up.logged=false;
+      memcpy(up.key,entry[middle].key,up.length);
+      encode_page(opt->page,entry+middle,count-middle,true,first);
+    }
+    else
+    {
+      memcpy(&up,&entry[middle],sizeof(entry_t));
+      encode_page(opt->page,entry+middle+1,count-middle-1,false,up.child);
+    }
+    if((status=append_page(opt,&right_block,opt->page))!=SUCCESS)
+      return status;
+    up.child=right_block;
+    encode_page(opt->page,entry,middle,is_leaf,
+		(is_leaf==true)?right_block:first);
+    if(depth>0)
+    {
+      if((status=write_page(opt,block,opt->page))!=SUCCESS||
+	 (status=read_page(opt,path[depth-1],opt->page))!=SUCCESS)
+	return status;
+      TRACE3(split_done,block,(unsigned int)opt->key,0U);
+      continue;
+    }
+
+    /*the root keeps its block:the left half moves out as well*/
+    TRACE3(root_split,block,(unsigned int)opt->key,0U);
+    if((status=append_page(opt,&left_block,opt->page))!=SUCCESS)
+      return status;
+    encode_page(opt->page,&up,1,false,left_block);
+    return write_page(opt,block,opt->page);
+  }
+}
+
+/****************************************************************************
+   search_string: Looks a key up in a string tree and passes its value to a
+		       function,if there is one.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the key,its length,and the function (or NULL) and
+			     its argument.
+  -output: SUCCESS if the key is present,E_NOT_FOUND or E_TREE_EMPTY if
+			   not,or another error.
+****************************************************************************/
+static status_t find_string(options_t *const opt,header_t *const h,
+			    const byte_t *const key,size_t length,
+			    long *const block,word_t *const index);
+
+static status_t search_string(options_t *const opt,header_t *const h,
+			      const byte_t *const key,size_t length,
+			      bp_value_fn fn,void *arg)
+{
+  const slot_t *const slot=(const slot_t *)(opt->page+sizeof(page_t));
+  status_t status;
+  word_t index;
+  long block;
+
+  if((status=find_string(opt,h,key,length,&block,&index))!=SUCCESS||
+     fn==NULL)
+    return status;
+  if(slot[index].logged!=0)
+    return read_log(opt,slot[index].child,fn,arg);
+  if(slot[index].child!=NO_BLOCK)
+    return read_overflow(opt,slot[index].child,fn,arg);
+  if(slot[index].value>0)
+    (*fn)(opt->page+slot[index].offset+slot[index].length,slot[index].value,
+	  arg);
+  return SUCCESS;
+}
+
+/****************************************************************************
+   write_overflow/read_overflow: Write a value to overflow pages in one run
+   at the end of the index file,and pass a value to a function page by
+	 page,reading on without a seek while its pages are adjacent.
+   -input: A constant pointer to the B+ tree's options,and the value,its
+       length and a pointer to receive its first page (or the first page,
+			    the function and its argument).
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t write_overflow(options_t *const opt,
+			       const byte_t *const value,size_t length,
+			       long *const block)
+{
+  overflow_t *const head=(overflow_t *)opt->page;
+  const size_t room=STRING_PAGE_SIZE-sizeof(overflow_t);
+  size_t done;
+  long next;
+
+  if(seek_file(opt,0L,SEEK_END)!=0||(*block=ftell(opt->iop))==-1L)
+    return E_MOVE_FILE;
+  for(next=*block,done=0;done<length;done+=head->used)
+  {
+    memset(opt->page,0,STRING_PAGE_SIZE);
+    head->tag=OVERFLOW_TAG;
+    head->length=length;
+    head->used=(length-done<room)?length-done:room;
+    next+=STRING_PAGE_SIZE;
+    head->next=(done+head->used<length)?next:NO_BLOCK;
+    memcpy(opt->page+sizeof(overflow_t),value+done,head->used);
+    if(fwrite(opt->page,STRING_PAGE_SIZE,1,opt->iop)!=1)
+      return E_WRITE_FILE;
+    COUNT_IO(opt,pages_written,1UL);
+    COUNT_IO(opt,bytes_written,(unsigned long)STRING_PAGE_SIZE);
+  }
+  return SUCCESS;
+}
+
+static status_t read_overflow(options_t *const opt,long block,
+			      bp_value_fn fn,void *arg)
+{
+  const overflow_t *const head=(const overflow_t *)opt->page;
+  long at;
+
+  for(at=NO_BLOCK;block!=NO_BLOCK;block=head->next)
+  {
+    if(block!=at&&seek_file(opt,block,SEEK_SET)!=0)
+      return E_MOVE_FILE;
+    if(fread(opt->page,STRING_PAGE_SIZE,1,opt->iop)!=1)
+      return E_READ_FILE;
+    COUNT_IO(opt,pages_read,1UL);
+    COUNT_IO(opt,cache_misses,1UL);
+    if(head->tag!=OVERFLOW_TAG)
+      return E_READ_FILE;
+    at=block+STRING_PAGE_SIZE;
+    if((*fn)(opt->page+sizeof(overflow_t),(size_t)head->used,arg)!=0)
+      break;
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   scan_strings: Calls a function for every key of a range of a string
+   tree,from the leaf of the lower bound along the chain of leaves.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the bounds (inclusive),the function and its
+				  argument.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t scan_strings(options_t *const opt,header_t *const h,
+			     const byte_t *const low,size_t low_length,
+			     const byte_t *const high,size_t high_length,
+			     bp_string_fn fn,void *arg)
+{
+  const page_t *const head=(const page_t *)opt->page;
+  const slot_t *const slot=(const slot_t *)(opt->page+sizeof(page_t));
+  byte_t key[BP_STRING_MAX];
+  status_t status;
+  boolean_t found;
+  word_t index;
+  long block;
+
+  if(h->root_block==NO_BLOCK)
+    return SUCCESS;
+  opt->key=(low_length>0)?low[0]:0;
+  for(block=h->root_block;;block=child_page(opt->page,low,low_length))
+  {
+    TRACE2(descend,block,(unsigned int)opt->key);
+    if((status=read_page(opt,block,opt->page))!=SUCCESS)
+      return status;
+    if(head->is_leaf==true)
+      break;
+  }
+  index=search_page(opt->page,low,low_length,&found);
+  for(;;)
+  {
+    memcpy(key,opt->page+STRING_PAGE_SIZE-head->prefix,head->prefix);
+    for(;index<head->slots;++index)
+    {
+      if(compare_slot(opt->page,index,high,high_length)>0)
+	return SUCCESS;
+      memcpy(key+head->prefix,opt->page+slot[index].offset,
+	     slot[index].length);
+      if((*fn)(key,head->prefix+slot[index].length,arg)!=0)
+	return SUCCESS;
+    }
+    if((block=head->first)==NO_BLOCK)
+      return SUCCESS;
+    if((status=read_page(opt,block,opt->page))!=SUCCESS)
+      return status;
+    index=0;
+  }
+}
+
+/****************************************************************************
+   find_string: Reads the leaf of a key of a string tree into the page of
+		       the options,and finds the key in it.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+    the B+ tree's header,the key,its length,and pointers to receive the
+			block of the leaf and the slot.
+  -output: SUCCESS if the key is present,E_NOT_FOUND or E_TREE_EMPTY if
+			   not,or another error.
+****************************************************************************/
+static status_t find_string(options_t *const opt,header_t *const h,
+			    const byte_t *const key,size_t length,
+			    long *const block,word_t *const index)
+{
+  status_t status;
+  boolean_t found;
+
+  if(h->root_block==NO_BLOCK)
+    return E_TREE_EMPTY;
+  opt->key=(length>0)?key[0]:0;
+  for(*block=h->root_block;;*block=child_page(opt->page,key,length))
+  {
+    TRACE2(descend,*block,(unsigned int)opt->key);
+    if((status=read_page(opt,*block,opt->page))!=SUCCESS)
+      return status;
+    if(((page_t *)opt->page)->is_leaf==true)
+      break;
+  }
+  *index=search_page(opt->page,key,length,&found);
+  return (found==true)?SUCCESS:E_NOT_FOUND;
+}
+
+/****************************************************************************
+   log_name: The name of a segment of the value log,or of the file that
+		  holds the first segment (segment -1).
+   -input: A constant pointer to the B+ tree's options,the segment and a
+		      buffer of LOG_NAME_SIZE bytes.
+			-output: The buffer.
+****************************************************************************/
+#define LOG_NAME_SIZE (FILE_BUFFER_SIZE+32)
+
+static char *log_name(const options_t *const opt,long segment,
+		      char *const name)
+{
+  if(segment<0)
+    sprintf(name,"%s.vlog",opt->name);
+  else
+    sprintf(name,"%s.v%ld",opt->name,segment);
+  return name;
+}
+
+/****************************************************************************
+   open_log: Opens the value log of a string tree,if it is not open:the
+   kept segments run from the one its head file names up to the last one
+		       there is,which takes appends.
+	 -input: A constant pointer to the B+ tree's options.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t open_log(options_t *const opt)
+{
+  char name[LOG_NAME_SIZE];
+  unsigned long head;
+  FILE *iop;
+
+  if(opt->log!=NULL)
+    return SUCCESS;
+  head=0UL;
+  if((iop=fopen(log_name(opt,-1L,name),"r"))!=NULL)
+  {
+    if(fscanf(iop,"%lu",&head)!=1)
+      head=0UL;
+    fclose(iop);
+  }
+  opt->log_head=opt->log_tail=head;
+  while((iop=fopen(log_name(opt,(long)opt->log_tail+1L,name),"rb"))!=NULL)
+  {
+    fclose(iop);
+    ++opt->log_tail;
+  }
+  if((opt->log=fopen(log_name(opt,(long)opt->log_tail,name),"a+b"))==NULL)
+    return E_OPEN_FILE;
+  if(fseek(opt->log,0L,SEEK_END)!=0)
+    return E_MOVE_FILE;
+  opt->log_end=(long)opt->log_tail*LOG_SEGMENT+ftell(opt->log);
+  opt->gc_offset=(long)opt->log_head*LOG_SEGMENT;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   roll_log: Starts a new segment of the value log once the last one is
+				   full.
+	 -input: A constant pointer to the B+ tree's options.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t roll_log(options_t *const opt)
+{
+  char name[LOG_NAME_SIZE];
+
+  if(opt->log_end-(long)opt->log_tail*LOG_SEGMENT<LOG_SEGMENT)
+    return SUCCESS;
+  if(fclose(opt->log)==EOF)
+  {
+    opt->log=NULL;
+    return E_CLOSE_FILE;
+  }
+  ++opt->log_tail;
+  if((opt->log=fopen(log_name(opt,(long)opt->log_tail,name),"a+b"))==NULL)
+    return E_OPEN_FILE;
+  opt->log_end=(long)opt->log_tail*LOG_SEGMENT;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   append_log: Appends a value to the value log,in a new segment once the
+			    last one is full.
+  -input: A constant pointer to the B+ tree's options,the key,the value,
+	  their lengths and a pointer to receive the offset.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t append_log(options_t *const opt,const byte_t *const key,
+			   size_t length,const byte_t *const value,
+			   size_t value_length,long *const offset)
+{
+  log_record_t record;
+  status_t status;
+
+  if((status=roll_log(opt))!=SUCCESS)
+    return status;
+  record.key_length=length;
+  record.length=value_length;
+  if(fseek(opt->log,0L,SEEK_END)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(&record,sizeof(log_record_t),1,opt->log)!=1||
+     fwrite(key,1,length,opt->log)!=length||
+     fwrite(value,1,value_length,opt->log)!=value_length)
+    return E_WRITE_FILE;
+  *offset=opt->log_end;
+  opt->log_end+=(long)(sizeof(log_record_t)+length+value_length);
+  opt->stats.log_bytes+=value_length;
+  COUNT_IO(opt,bytes_written,
+	   (unsigned long)(sizeof(log_record_t)+length+value_length));
+  return SUCCESS;
+}
+
+/****************************************************************************
+   log_file: The file of a segment of the value log;the last one is always
+   open and one older one is kept open,for the collector goes through the
+			     oldest in turn.
+   -input: A constant pointer to the B+ tree's options,the segment and a
+			pointer to receive the file.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t log_file(options_t *const opt,unsigned long segment,
+			 FILE **const iop)
+{
+  char name[LOG_NAME_SIZE];
+
+  if(segment==opt->log_tail)
+  {
+    *iop=opt->log;
+    return SUCCESS;
+  }
+  if(opt->log_old==NULL||opt->log_old_segment!=segment)
+  {
+    if(opt->log_old!=NULL)
+      fclose(opt->log_old);
+    if((opt->log_old=fopen(log_name(opt,(long)segment,name),"rb"))==NULL)
+      return E_OPEN_FILE;
+    opt->log_old_segment=segment;
+  }
+  *iop=opt->log_old;
+  return SUCCESS;
+}
+
+/****************************************************************************
+   read_log: Passes a value in the value log to a function,in pieces of a
+				   page.
+  -input: A constant pointer to the B+ tree's options,the offset of the
+		  value,the function and its argument.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t read_log(options_t *const opt,long offset,bp_value_fn fn,
+			 void *arg)
+{
+  log_record_t record;
+  status_t status;
+  size_t piece;
+  FILE *iop;
+
+  if((status=open_log(opt))!=SUCCESS||
+     (status=log_file(opt,(unsigned long)(offset/LOG_SEGMENT),&iop))!=SUCCESS)
+    return status;
+  COUNT_IO(opt,seeks,1UL);
+  if(fseek(iop,offset%LOG_SEGMENT,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fread(&record,sizeof(log_record_t),1,iop)!=1||
+     fseek(iop,(long)record.key_length,SEEK_CUR)!=0)
+    return E_READ_FILE;
+  for(;record.length>0;record.length-=piece)
+  {
+    piece=(record.length<STRING_PAGE_SIZE)?record.length:STRING_PAGE_SIZE;
+    if(fread(opt->page,1,piece,iop)!=piece)
+      return E_READ_FILE;
+    COUNT_IO(opt,pages_read,1UL);
+    if((*fn)(opt->page,piece,arg)!=0)
+      break;
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   gc_log: A step of the collector of the value log,see bp_log_gc().  The
+   log is flushed before the leaves that point into it,and both before a
+			  segment is removed.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+	 the B+ tree's header and the log bytes to look at.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t gc_log(options_t *const opt,header_t *const h,size_t bytes)
+{
+  slot_t *const slot=(slot_t *)(opt->page+sizeof(page_t));
+  byte_t key[BP_STRING_MAX];
+  char name[LOG_NAME_SIZE];
+  log_record_t record;
+  long block,offset;
+  size_t done;
+  status_t status;
+  unsigned long last;
+  word_t index;
+  FILE *iop;
+
+  /*values moved now go past the segments there are,and stay there*/
+  for(done=0,last=opt->log_tail;done<bytes&&opt->log_head<last;)
+  {
+    if(opt->gc_offset<(long)opt->log_head*LOG_SEGMENT)
+      opt->gc_offset=(long)opt->log_head*LOG_SEGMENT;
+    if((status=log_file(opt,opt->log_head,&iop))!=SUCCESS)
+      return status;
+    if(fseek(iop,opt->gc_offset-(long)opt->log_head*LOG_SEGMENT,
+	     SEEK_SET)!=0)
+      return E_MOVE_FILE;
+    if(fread(&record,sizeof(log_record_t),1,iop)!=1)
+    {
+      /*every live value of the segment is further on in the log*/
+      if(fflush(opt->log)==EOF||(status=flush_file(opt))!=SUCCESS)
+	return E_WRITE_FILE;
+      fclose(opt->log_old);
+      opt->log_old=NULL;
+      remove(log_name(opt,(long)opt->log_head,name));
+      opt->gc_offset=(long)(++opt->log_head)*LOG_SEGMENT;
+      ++opt->stats.gc_freed;
+      if((iop=fopen(log_name(opt,-1L,name),"w"))==NULL)
+	return E_OPEN_FILE;
+      fprintf(iop,"%lu\n",opt->log_head);
+      if(fclose(iop)==EOF)
+	return E_CLOSE_FILE;
+      continue;
+    }
+    if(record.key_length>BP_STRING_MAX||
+       fread(key,1,record.key_length,iop)!=record.key_length)
+      return E_READ_FILE;
+    offset=opt->gc_offset;
+    opt->gc_offset+=(long)(sizeof(log_record_t)+record.key_length+
+			   record.length);
+    done+=sizeof(log_record_t)+record.key_length+record.length;
+    status=find_string(opt,h,key,record.key_length,&block,&index);
+    if(status==E_NOT_FOUND||status==E_TREE_EMPTY)
+      continue;
+    if(status!=SUCCESS)
+      return status;
+    if(slot[index].logged==0||slot[index].child!=offset)
+      continue;  /*the value was replaced*/
+    if((status=copy_log(opt,iop,key,&record,&offset))!=SUCCESS)
+      return status;
+    if(fflush(opt->log)==EOF)
+      return E_WRITE_FILE;
+    slot[index].child=offset;
+    if((status=write_page(opt,block,opt->page))!=SUCCESS)
+      return status;
+  }
+  if(fflush(opt->log)==EOF)
+    return E_WRITE_FILE;
+  return flush_file(opt);
+}
+
+/****************************************************************************
+   copy_log: Appends a record of the value log,read from an older segment
+   past its key,to the log again,a page at a time,however long its value.
+   -input: A constant pointer to the B+ tree's options,the file of the
+   older segment,the key,the record and a pointer to receive the offset.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t copy_log(options_t *const opt,FILE *const iop,
+			 const byte_t *const key,
+			 const log_record_t *const record,long *const offset)
+{
+  byte_t value[STRING_PAGE_SIZE];
+  unsigned long left;
+  status_t status;
+  size_t piece;
+
+  if((status=roll_log(opt))!=SUCCESS)
+    return status;
+  if(fseek(opt->log,0L,SEEK_END)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(record,sizeof(log_record_t),1,opt->log)!=1||
+     fwrite(key,1,record->key_length,opt->log)!=record->key_length)
+    return E_WRITE_FILE;
+  for(left=record->length;left>0;left-=piece)
+  {
+    piece=(left<STRING_PAGE_SIZE)?left:STRING_PAGE_SIZE;
+    if(fread(value,1,piece,iop)!=piece)
+      return E_READ_FILE;
+    if(fwrite(value,1,piece,opt->log)!=piece)
+      return E_WRITE_FILE;
+  }
+  *offset=opt->log_end;
+  opt->log_end+=(long)(sizeof(log_record_t)+record->key_length+
+		       record->length);
+  opt->stats.gc_moved+=record->length;
+  COUNT_IO(opt,bytes_written,(unsigned long)(sizeof(log_record_t)+
+					    record->key_length+record->length));
+  return SUCCESS;
+}
+
+/****************************************************************************
+   build_height/build_split/build_nodes: The shape of a subtree of a bulk
+   build with up to per keys a node:the fewest levels that hold its keys,
+   the children of its root,each as many keys as the next,and the nodes
+				   in it.
+   -input: The keys of the subtree,its height,the keys a node holds and
+		     an array to receive the children's keys.
+   -output: The height,the number of children or the number of nodes.
+****************************************************************************/
+static int build_height(size_t count,int per)
+{
+  unsigned long room;
+  int height;
+
+  for(height=1,room=(unsigned long)per;room<count;++height)
+    room=room*(unsigned long)(per+1)+(unsigned long)per;
+  return height;
+}
+
+static int build_split(size_t count,int height,int per,size_t *const size)
+{
+  unsigned long room;
+  size_t rest;
+  int child,children;
+
+  for(room=0UL;--height>0;)  /*the keys a child holds*/
+    room=room*(unsigned long)(per+1)+(unsigned long)per;
+  children=(int)((count+1+room)/(room+1));  /*ceil((count+1)/(room+1))*/
+  rest=count-(size_t)(children-1);
+  for(child=0;child<children;++child)
+    size[child]=rest/(size_t)children+(((size_t)child<rest%children)?1:0);
+  return children;
+}
+
+static unsigned long build_nodes(size_t count,int height,int per)
+{
+  size_t size[TREE_ORDER+1];
+  unsigned long nodes;
+  int child,children;
+
+  if(height==1)
+    return 1UL;
+  children=build_split(count,height,per,size);
+  for(nodes=1UL,child=0;child<children;++child)
+    nodes+=build_nodes(size[child],height-1,per);
+  return nodes;
+}
+
+/****************************************************************************
+   build_subtree: Writes a subtree of a bulk build,its root and then the
+   subtree of each child,down to a number of levels;the subtrees below
+   are left for the threads,in the order they lie in the file.  The stream
+   seeks only where the file skips a subtree,and writes on sequentially.
+   -input: The builder,the B+ tree's header,the subtree,the keys a node
+   holds,the levels to write (-1 for all) and an array to receive the
+		 subtrees left with a pointer to their number.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t build_subtree(builder_t *const b,const header_t *const h,
+			      const build_t *const sub,int per,int levels,
+			      build_t *const units,size_t *const used)
+{
+  size_t size[TREE_ORDER+1];
+  const word_t *values;
+  int child,children;
+  status_t status;
+  build_t below;
+  node_t node;
+  word_t index;
+
+  if(levels==0)
+  {
+    memcpy(&units[(*used)++],sub,sizeof(build_t));
+    return SUCCESS;
+  }
+  memset(&node,0,sizeof(node_t));
+  node.is_leaf=(sub->height==1)?true:false;
+  node.parent_block=sub->parent;
+  for(index=0;index<=TREE_ORDER;++index)
+    node.block[index]=NO_BLOCK;
+  for(index=0;index<TREE_ORDER;++index)
+    node.ref[index]=NO_BLOCK;
+  children=0;
+  if(node.is_leaf==true)
+  {
+    node.keys_used=(word_t)sub->count;
+    memcpy(node.key,sub->values,sub->count*sizeof(word_t));
+  }
+  else
+  {
+    children=build_split(sub->count,sub->height,per,size);
+    node.keys_used=(word_t)(children-1);
+    below.block=sub->block+(long)h->block_size;
+    for(values=sub->values,child=0;child<children;++child)
+    {
+      node.block[child]=below.block;
+      node.count[child]=(COUNTED(h))?(unsigned long)size[child]:0UL;
+      values+=size[child];
+      if(child<children-1)
+	node.key[child]=*values++;
+      below.block+=(long)h->block_size*
+	(long)build_nodes(size[child],sub->height-1,per);
+    }
+  }
+  if(b->at!=sub->block&&fseek(b->iop,sub->block,SEEK_SET)!=0)
+    return E_MOVE_FILE;
+  if(fwrite(&node,h->block_size,1,b->iop)!=1)
+    return E_WRITE_FILE;
+  b->at=sub->block+(long)h->block_size;
+  ++b->nodes;
+
+  below.height=sub->height-1;
+  below.parent=sub->block;
+  for(values=sub->values,child=0;child<children;++child)
+  {
+    below.values=values;
+    below.count=size[child];
+    below.block=node.block[child];
+    if((status=build_subtree(b,h,&below,per,(levels>0)?levels-1:-1,units,
+			     used))!=SUCCESS)
+      return status;
+    values+=size[child]+1;
+  }
+  return SUCCESS;
+}
+
+/****************************************************************************
+   build_tree: Lays a bulk build out at the end of the index file,on one
+   thread or,down to where there are BUILD_UNITS subtrees a thread,on the
+	  caller's,then points the header at the root.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the keys,how many,the keys a node holds and the
+				  threads.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t build_tree(options_t *const opt,header_t *const h,
+			   const word_t *const values,size_t count,int per,
+			   int threads)
+{
+  status_t status;
+  build_t root;
+  builder_t b;
+  int levels;
+#if defined(BP_THREADS)
+  unsigned long fan;
+#endif
+
+  if(seek_file(opt,0L,SEEK_END)!=0||(root.block=ftell(opt->iop))==-1L)
+    return E_MOVE_FILE;
+  root.values=values;
+  root.count=count;
+  root.height=build_height(count,per);
+  root.parent=NO_BLOCK;
+  b.iop=opt->iop;
+  b.at=root.block;
+  b.nodes=0UL;
+  if(threads>BUILD_THREADS)
+    threads=BUILD_THREADS;
+  levels=0;
+#if defined(BP_THREADS)
+  for(fan=1UL;threads>1&&levels<root.height-1&&
+	fan<(unsigned long)(threads*BUILD_UNITS);++levels)
+    fan*=(unsigned long)(per+1);
+#endif
+  if(levels==0)  /*one thread builds it all*/
+    status=build_subtree(&b,h,&root,per,-1,NULL,NULL);
+#if defined(BP_THREADS)
+  else
+    status=build_parallel(opt,h,&b,&root,per,levels,fan,threads);
+#endif
+  COUNT_IO(opt,pages_written,b.nodes);
+  COUNT_IO(opt,bytes_written,b.nodes*(unsigned long)h->block_size);
+  if(status!=SUCCESS)
+    return status;
+  ++opt->epoch;
+  opt->tail_block=opt->top_block=NO_BLOCK;
+  h->root_block=root.block;
+  return write_header(opt,h);
+}
+
+#if defined(BP_THREADS)
+/****************************************************************************
+   build_part: Builds subtrees of a bulk build through a stream of its own,
+			as the body of a worker thread.
+    -input: A pointer to a build_part_t with the subtrees to build.
+			   -output: Nothing.
+****************************************************************************/
+typedef struct
+{
+  const char *name;  /*the index file*/
+  const header_t *h;  /*its header*/
+  const build_t *units;  /*the subtrees to build*/
+  size_t count;  /*how many*/
+  int per;  /*the keys a node holds*/
+  unsigned long nodes;  /*the nodes written*/
+  status_t status;  /*how it went*/
+} build_part_t;
+
+static void *build_part(void *arg)
+{
+  build_part_t *const part=(build_part_t *)arg;
+  builder_t b;
+  size_t index;
+
+  b.nodes=0UL;
+  b.at=-1L;
+  part->status=SUCCESS;
+  if((b.iop=fopen(part->name,"r+b"))==NULL)
+  {
+    part->status=E_OPEN_FILE;
+    return NULL;
+  }
+  for(index=0;index<part->count&&part->status==SUCCESS;++index)
+    part->status=build_subtree(&b,part->h,&part->units[index],part->per,-1,
+			       NULL,NULL);
+  if(fclose(b.iop)==EOF&&part->status==SUCCESS)
+    part->status=E_WRITE_FILE;
+  part->nodes=b.nodes;
+  return NULL;
+}
+
+/****************************************************************************
+   build_parallel: Writes the top levels of a bulk build,then splits the
+   subtrees below among threads in runs of consecutive blocks and waits
+				   for them.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the builder of the top levels,the whole tree,the
+   keys a node holds,the top levels,the most subtrees below them and the
+				  threads.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t build_parallel(options_t *const opt,header_t *const h,
+			       builder_t *const b,const build_t *const root,
+			       int per,int levels,unsigned long fan,
+			       int threads)
+{
+  build_part_t part[BUILD_THREADS];
+  pthread_t thread[BUILD_THREADS];
+  size_t used,share,next;
+  int index,started;
+  status_t status;
+  build_t *units;
+
+  if((units=(build_t *)malloc(fan*sizeof(build_t)))==NULL)
+    return E_NO_MEMORY;
+  used=0;
+  if((status=build_subtree(b,h,root,per,levels,units,&used))==SUCCESS&&
+     fflush(opt->iop)==EOF)
+    status=E_WRITE_FILE;
+  share=(used+(size_t)threads-1)/(size_t)threads;
+  for(started=0,next=0;status==SUCCESS&&started<threads&&next<used;
+      ++started,next+=share)
+  {
+    part[started].name=(opt->catalog!=NULL)?opt->catalog->name:opt->name;
+    part[started].h=h;
+    part[started].units=units+next;
+    part[started].count=(next+share>used)?used-next:share;
+    part[started].per=per;
+    part[started].nodes=0UL;
+    if(pthread_create(&thread[started],NULL,build_part,&part[started])!=0)
+      status=E_NO_MEMORY;
+  }
+  if(status!=SUCCESS&&started>0)
+    --started;  /*the last one did not start*/
+  for(index=0;index<started;++index)
+  {
+    pthread_join(thread[index],NULL);
+    if(status==SUCCESS)
+      status=part[index].status;
+    b->nodes+=part[index].nodes;
+  }
+  free(units);
+  return status;
+}
+#endif
+
+/****************************************************************************
+   spill_run: Writes a sorted run of a load to a temporary file,which goes
+		      away when it is closed.
+   -input: The keys,how many and a pointer to receive the open file,at its
+				  start.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t spill_run(const word_t *const values,size_t count,
+			  FILE **const iop)
+{
+  if((*iop=tmpfile())==NULL)
+    return E_CREATE_FILE;
+  if((count>0&&fwrite(values,sizeof(word_t),count,*iop)!=count)||
+     fflush(*iop)==EOF)
+  {
+    fclose(*iop);
+    *iop=NULL;
+    return E_WRITE_FILE;
+  }
+  rewind(*iop);
+  return SUCCESS;
+}
+
+/****************************************************************************
+   sift_run: Moves a run of a merge down its heap until no run below it
+			     has a smaller key.
+   -input: The heap of runs,its size,the next key of every run and where
+			      the run is.
+			      -output: None.
+****************************************************************************/
+static void sift_run(int *const heap,int size,const word_t *const head,
+		     int at)
+{
+  int child,run;
+
+  for(run=heap[at];(child=2*at+1)<size;at=child)
+  {
+    if(child+1<size&&head[heap[child+1]]<head[heap[child]])
+      ++child;
+    if(head[run]<=head[heap[child]])
+      break;
+    heap[at]=heap[child];
+  }
+  heap[at]=run;
+  return;
+}
+
+/****************************************************************************
+   merge_runs: Merges sorted runs into one without duplicates,through a
+   heap of the runs ordered by their next key.  The runs are closed,and
+		    their slots set to NULL.
+   -input: The runs,how many (up to SORT_FAN_IN),the temporary file that
+   receives the merge,or NULL and an array to receive it with a pointer to
+			  the number of its keys.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t merge_runs(FILE **const runs,int count,FILE *const out,
+			   word_t *const values,size_t *const used)
+{
+  word_t head[SORT_FAN_IN],last;
+  int heap[SORT_FAN_IN],size,index;
+  status_t status;
+  boolean_t any;
+
+  for(size=index=0;index<count;++index)
+    if(fread(&head[index],sizeof(word_t),1,runs[index])==1)
+      heap[size++]=index;
+  for(index=size/2-1;index>=0;--index)
+    sift_run(heap,size,head,index);
+  if(used!=NULL)
+    *used=0;
+  last=0;
+  status=SUCCESS;
+  for(any=false;size>0&&status==SUCCESS;sift_run(heap,size,head,0))
+  {
+    index=heap[0];
+    if(any==false||head[index]!=last)
+    {
+      any=true;
+      last=head[index];
+      if(out==NULL)
+	values[(*used)++]=last;
+      else if(fwrite(&last,sizeof(word_t),1,out)!=1)
+	status=E_WRITE_FILE;
+    }
+    if(fread(&head[index],sizeof(word_t),1,runs[index])!=1)
+      heap[0]=heap[--size];  /*the run is used up*/
+  }
+  for(index=0;index<count;++index)
+  {
+    if(ferror(runs[index])&&status==SUCCESS)
+      status=E_READ_FILE;
+    fclose(runs[index]);
+    runs[index]=NULL;
+  }
+  if(out!=NULL&&status==SUCCESS)
+    status=(fflush(out)==EOF)?E_WRITE_FILE:SUCCESS;
+  if(out!=NULL)
+    rewind(out);
+  return status;
+}
+
+/****************************************************************************
+   compact_layout: Starts writing the new layout of a compaction at a
+   block:the levels above the last two now,the subtrees below them left
+			     for later steps.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the compaction,where the layout goes and a pointer
+			     to the pages left.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t compact_layout(options_t *const opt,header_t *const h,
+			       compact_t *const c,long block,
+			       unsigned long *const pages)
+{
+  status_t status;
+  builder_t b;
+  int levels;
+
+  c->root.block=block;
+  levels=(c->root.height>2)?c->root.height-2:0;
+  b.iop=opt->iop;
+  b.at=-1L;  /*other I/O may have moved the stream*/
+  b.nodes=0UL;
+  c->used=c->next=0;
+  status=build_subtree(&b,h,&c->root,c->per,levels,c->units,&c->used);
+  COUNT_IO(opt,pages_written,b.nodes);
+  COUNT_IO(opt,bytes_written,b.nodes*(unsigned long)h->block_size);
+  *pages-=(b.nodes<*pages)?b.nodes:*pages;
+  return status;
+}
+
+/****************************************************************************
+   compact_switch: Points the header at the layout a compaction has just
+   written,then adds to it the keys that came after the reading,in one
+		  sorted pass as bp_insert_batch() does.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+	      the B+ tree's header,the compaction and true to cut
+		    the file after the layout first.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t compact_switch(options_t *const opt,header_t *const h,
+			       compact_t *const c,boolean_t cut)
+{
+  status_t status;
+
+  if(fflush(opt->iop)==EOF)
+    return E_WRITE_FILE;
+  ++opt->epoch;
+  opt->tail_block=opt->top_block=NO_BLOCK;
+  opt->top_dirty=false;  /*the late keys carry its inserts over*/
+  h->root_block=c->root.block;
+  if((status=write_header(opt,h))!=SUCCESS)
+    return status;
+  if(cut==true&&TRUNCATE_FILE(opt->iop,(long)h->header_size+c->size)!=0)
+    return E_WRITE_FILE;
+  if(c->lates==0)
+    return SUCCESS;
+  qsort(c->late,c->lates,sizeof(word_t),compare_words);
+  if((status=merge_values(opt,h,c->late,c->lates))!=SUCCESS)
+    return status;
+  return flush_file(opt);
+}
+
+/****************************************************************************
+   compact_read: Reads keys of the tree into the bitmap of a compaction in
+   ascending order,from the key the last step stopped at,until the pages
+   of the step are spent;the path down to that key,which the last step
+   read too,is not counted.  Reading by key rather than by node keeps a
+   key that a split has moved since the last step from being missed;the
+		keys added below it are taken in by note_compact().
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+	 the B+ tree's header,the compaction and the pages of the step.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t compact_read(options_t *const opt,header_t *const h,
+			     compact_t *const c,unsigned long pages)
+{
+  unsigned long start;
+  snapshot_t *snap;
+  status_t status;
+  cursor_t *cur;
+  word_t value;
+
+  if((cur=(cursor_t *)malloc(sizeof(cursor_t)))==NULL)
+    return E_NO_MEMORY;
+  if((status=open_snapshot(opt,h,&snap))!=SUCCESS)
+  {
+    free(cur);
+    return status;
+  }
+  if((status=open_cursor(opt,h,snap,(word_t)c->resume,cur))==SUCCESS)
+    for(start=opt->stats.total.pages_read+opt->stats.total.cache_hits;;)
+    {
+      if(POSTINGS(h)&&cur->depth>=0&&  /*every key of a node passes here*/
+	 cur->node[cur->depth].ref[cur->pos[cur->depth]]!=NO_BLOCK)
+      {
+	status=E_NO_COMPACT;
+	break;
+      }
+      if((status=next_cursor(opt,h,cur,&value))!=SUCCESS)
+	break;
+      if(!KEY_IN_RANGE(value))
+      {
+	status=E_NO_COMPACT;
+	break;
+      }
+      c->seen[value>>3]|=(byte_t)(1<<(value&7));
+      c->resume=(long)value+1L;
+      if(opt->stats.total.pages_read+opt->stats.total.cache_hits-start>=
+	 pages)
+	break;
+    }
+  close_snapshot(opt,snap);
+  free(cur);
+  if(status==E_END_OF_SCAN)
+  {
+    c->resume=WORD_T_MAX+1L;
+    status=SUCCESS;
+  }
+  return status;
+}
+
+/****************************************************************************
+   compact_tree: Runs a step of a compaction:reads keys into a bitmap,or
+   writes subtrees of the new layout,until the pages of the step are spent,
+	     and moves on to the next stage when one is done.
+  -input: A constant pointer to the B+ tree's options,a constant pointer to
+   the B+ tree's header,the percentage of a node to fill,the pages of the
+       step and a pointer to receive 1 once the compaction is through.
+	-output: A status_t value indicating success or an error.
+****************************************************************************/
+static status_t compact_tree(options_t *const opt,header_t *const h,
+			     int fill,unsigned long pages,int *const done)
+{
+  status_t status;
+  compact_t *c;
+  builder_t b;
+  long key;
+
+  if((c=opt->compact)!=NULL&&c->failed!=SUCCESS)  /*see note_compact()*/
+    return c->failed;
+  if(c==NULL)
+  {
+    if(h->root_block==NO_BLOCK)
+    {
+      *done=1;
+      return SUCCESS;
+    }
+    if((c=(compact_t *)calloc(1,sizeof(compact_t)))==NULL)
+      return E_NO_MEMORY;
+    opt->compact=c;
+    c->stage=COMPACT_READ;
+    c->failed=SUCCESS;
+    c->per=(fill*((int)h->tree_order-1)+50)/100;
+    if(c->per<1)
+      c->per=1;
+    if(c->per>(int)h->tree_order-1)
+      c->per=(int)h->tree_order-1;
+    c->resume=0L;
+  }
+  for(;;)
+    switch(c->stage)
+    {
+      case COMPACT_READ:
+	if((status=compact_read(opt,h,c,pages))!=SUCCESS)
+	  return status;
+	if(c->resume<=WORD_T_MAX)
+	  return SUCCESS;
+	for(key=0,c->count=0;key<=WORD_T_MAX;++key)
+	  c->count+=(c->seen[key>>3]>>(key&7))&1;
+	if((c->values=(word_t *)malloc(c->count*sizeof(word_t)))==NULL||
+	   (c->units=(build_t *)malloc((c->count+1)*sizeof(build_t)))==NULL)
+	  return E_NO_MEMORY;
+	for(key=0,c->count=0;key<=WORD_T_MAX;++key)
+	  if(((c->seen[key>>3]>>(key&7))&1)!=0)
+	    c->values[c->count++]=(word_t)key;
+	c->root.values=c->values;
+	c->root.count=c->count;
+	c->root.height=build_height(c->count,c->per);
+	c->root.parent=NO_BLOCK;
+	c->size=(long)build_nodes(c->count,c->root.height,c->per)*
+		(long)h->block_size;
+	if(seek_file(opt,0L,SEEK_END)!=0||(c->copy=ftell(opt->iop))==-1L)
+	  return E_MOVE_FILE;
+	if(c->copy<(long)h->header_size+c->size)  /*clear of the front*/
+	  c->copy=(long)h->header_size+c->size;
+	if(seek_file(opt,c->copy+c->size-1L,SEEK_SET)!=0)
+	  return E_MOVE_FILE;
+	if(putc(0,opt->iop)==EOF)  /*updates go past the copy*/
+	  return E_WRITE_FILE;
+	if((status=compact_layout(opt,h,c,c->copy,&pages))!=SUCCESS)
+	  return status;
+	c->stage=COMPACT_COPY;
+	break;
+      case COMPACT_WAIT:  /*the old layout may be read by a snapshot*/
+	if(opt->snapshots!=NULL)
+	  return SUCCESS;
+	if((status=compact_layout(opt,h,c,(long)h->header_size,&pages))!=
+	   SUCCESS)
+	  return status;
+	c->stage=COMPACT_MOVE;
+	break;
+      default:  /*copy or move*/
+	b.iop=opt->iop;
+	b.at=-1L;
+	for(b.nodes=0UL;c->next<c->used&&b.nodes<pages;++c->next)
+	  if((status=build_subtree(&b,h,&c->units[c->next],c->per,-1,NULL,
+				   NULL))!=SUCCESS)
+	    return status;
+	COUNT_IO(opt,pages_written,b.nodes);
+	COUNT_IO(opt,bytes_written,b.nodes*(unsigned long)h->block_size);
+	pages-=(b.nodes<pages)?b.nodes:pages;
+	if(c->next<c->used||(c->stage==COMPACT_MOVE&&opt->snapshots!=NULL))
+	  return SUCCESS;  /*more to write,or a snapshot reads the copy*/
+	if((status=compact_switch(opt,h,c,(c->stage==COMPACT_MOVE)?
+				  true:false))!=SUCCESS)
+	  return status;
+	if(c->stage==COMPACT_COPY)
+	{
+	  c->stage=COMPACT_WAIT;
+	  break;
+	}
+	*done=1;
+	return SUCCESS;
+    }
+}
+
+/****************************************************************************
+   note_compact: Takes keys an update adds into the compaction under way,
+   if any:while it reads,a bit in its bitmap;once the new layout is set,a
+   place in late[] too,for compact_switch() to add to the layout that takes
+   over.  A key already in the bitmap is in the layout or in late[].  The
+		    keys are noted before they go in.
+  -input: A constant pointer to the B+ tree's options,the keys and how many.
+			      -output: None.
+****************************************************************************/
+static void note_compact(options_t *const opt,const word_t *const values,
+			 size_t count)
+{
+  compact_t *const c=opt->compact;
+  word_t *late;
+  size_t index;
+
+  if(c==NULL)
+    return;
+  for(index=0;index<count&&c->failed==SUCCESS;++index)
+  {
+    if(!KEY_IN_RANGE(values[index]))
+    {
+      c->failed=E_NO_COMPACT;
+      break;
+    }
+    if(((c->seen[values[index]>>3]>>(values[index]&7))&1)!=0)
+      continue;
+    c->seen[values[index]>>3]|=(byte_t)(1<<(values[index]&7));
+    if(c->stage==COMPACT_READ)
+      continue;
+    if(c->lates==c->room)
+    {
+      c->room=(c->room>0)?c->room*2:64;
+      if((late=(word_t *)realloc(c->late,c->room*sizeof(word_t)))==NULL)
+      {
+	c->failed=E_NO_MEMORY;
+	break;
+      }
+      c->late=late;
+    }
+    c->late[c->lates++]=values[index];
+  }
+  return;
+}
+
+/****************************************************************************
+	   end_compact: Drops the compaction under way,if any.
+	   -input: A constant pointer to the B+ tree's options.
+			      -output: None.
+****************************************************************************/
+static void end_compact(options_t *const opt)
+{
+  if(opt->compact!=NULL)
+  {
+    free(opt->compact->values);
+    free(opt->compact->units);
+    free(opt->compact->late);
+    free(opt->compact);
+    opt->compact=NULL;
+  }
+  return;
+}